@@ -60,11 +60,21 @@ extern "C"
         ax_dev_errcode_axcl_sysdeinit_failed,
     } ax_dev_errcode_e;
 
+    // NPU partitioning applied when the engine is initialized, values match AX_ENGINE_NPU_MODE_T / axclrtEngineVNpuKind
+    typedef enum
+    {
+        ax_dev_vnpu_disable = 0,    // whole NPU, one model at a time per core set
+        ax_dev_vnpu_std = 1,        // three equal virtual NPUs
+        ax_dev_vnpu_big_little = 2, // virtual NPU 0 = big (2 cores), virtual NPU 1 = little (1 core)
+        ax_dev_vnpu_little_big = 3, // virtual NPU 0 = little (1 core), virtual NPU 1 = big (2 cores)
+    } ax_dev_vnpu_mode_e;
+
     typedef enum
     {
         unknown_device = 0,
         host_device = 1,
-        axcl_device = 2
+        axcl_device = 2,
+        mock_device = 3 // CPU stand-in for the NPU, model paths name mock specs (see ax_model_runner_mock.hpp)
     } ax_devive_e;
 
     typedef struct
@@ -102,6 +112,9 @@ extern "C"
 
     AX_API int AX_CALL ax_dev_enum_devices(ax_devices_t *devices);
     AX_API int AX_CALL ax_dev_sys_init(ax_devive_e dev_type, char devid);
+    // Same as ax_dev_sys_init with the NPU split into virtual NPUs, encoders are then pinned
+    // to one of them with clip_init_t::image_npu_affinity / text_npu_affinity (bit i = virtual NPU i)
+    AX_API int AX_CALL ax_dev_sys_init_vnpu(ax_devive_e dev_type, char devid, ax_dev_vnpu_mode_e vnpu_mode);
     AX_API int AX_CALL ax_dev_sys_deinit(ax_devive_e dev_type, char devid);
 
 #ifdef __cplusplus
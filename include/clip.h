@@ -53,6 +53,7 @@ extern "C"
 #define CLIP_KEY_MAX_LEN 64
 #define CLIP_PATH_LEN 128
 #define CLIP_TEXT_FEAT_MAX_LEN 1024
+#define CLIP_MAX_POOL_DEVICES 8
 
     typedef enum
     {
@@ -60,6 +61,7 @@ extern "C"
         clip_errcode_success = 0,
 
         clip_errcode_invalid_ptr,
+        clip_errcode_invalid_param,
 
         clip_errcode_create_failed = 0x10000,
         clip_errcode_create_failed_sys,
@@ -74,6 +76,8 @@ extern "C"
         clip_errcode_add_failed_key_exist,
         clip_errcode_add_failed_encode_image,
         clip_errcode_add_failed_push_db,
+        clip_errcode_add_failed_decode_image,
+        clip_errcode_add_failed_near_duplicate,
 
         clip_errcode_remove_failed = 0x40000,
         clip_errcode_remove_failed_key_not_exist,
@@ -82,9 +86,15 @@ extern "C"
         clip_errcode_match_failed = 0x50000,
         clip_errcode_match_failed_encode_text,
         clip_errcode_match_failed_encode_image,
+
+        clip_errcode_classifier_failed = 0x60000,
+        clip_errcode_classifier_failed_encode_text,
+        clip_errcode_classifier_failed_io,
+        clip_errcode_classifier_failed_mismatch,
     } clip_errcode_e;
 
     typedef void *clip_handle_t;
+    typedef void *clip_classifier_t;
 
     // Model type enum
     typedef enum
@@ -105,6 +115,25 @@ extern "C"
         char tokenizer_path[CLIP_PATH_LEN];     // Tokenizer model path
         char db_path[CLIP_PATH_LEN];            // Database path (if empty path is specified, a folder will be created)
         model_type_e model_type;                // Model type (clip, cn_clip, jina_clip_v2, siglip2, etc.)
+        int text_cache_size;                    // Max cached text features (0 uses 256, < 0 disables the cache)
+        char text_cache_persist;                // Also keep text features on disk in "<db_path>.text_cache"
+        int image_npu_affinity;                 // NPU core mask the image encoder runs on (0 keeps the engine default),
+                                                // virtual NPU mask when initialized with ax_dev_sys_init_vnpu
+        int text_npu_affinity;                  // NPU core mask the text encoder runs on (0 keeps the engine default),
+                                                // virtual NPU mask when initialized with ax_dev_sys_init_vnpu
+        char lazy_load;                         // Load each encoder on its first use instead of in clip_create
+        int idle_unload_ms;                     // Unload an encoder unused for this long, reloaded on next use (0 = never)
+        int image_io_slots;                     // Execution contexts of the image encoder, concurrent image encodes
+                                                // up to this count run side by side on one loaded model (0 = 1);
+                                                // with >= 2 a batched encode pipelines upload/execute/download
+        int image_replica_cores;                // NPU core mask for replica mode: one image encoder instance per set bit,
+                                                // each encode goes to the least-loaded one (0 = single instance)
+        int pool_num_devices;                   // AXCL device pool: load the image encoder on every card in pool_devids
+        char pool_devids[CLIP_MAX_POOL_DEVICES];// and balance encodes across them, the text encoder stays on devid (0 = off)
+        char parallel_startup;                  // Load the encoders, tokenizer and db concurrently in clip_create,
+                                                // every failing stage is reported (0 = one after another)
+        int io_pool_mb;                         // Carve the encoders' io buffers out of per-device blocks of this many MB,
+                                                // shared by all handles on the device (0 = one allocation per tensor)
     } clip_init_t;
 
     typedef struct
@@ -116,6 +145,14 @@ extern "C"
         int stride;
     } clip_image_t;
 
+    typedef struct
+    {
+        int x;
+        int y;
+        int width;
+        int height;
+    } clip_rect_t;
+
     typedef struct
     {
         float feat[CLIP_TEXT_FEAT_MAX_LEN];
@@ -128,6 +165,77 @@ extern "C"
         float score;
     } clip_result_item_t;
 
+    // Near-duplicate gate applied by clip_add / clip_add_batch / clip_ingest_paths before encoding
+    typedef enum
+    {
+        clip_dedup_off = 0, // Encode every image
+        clip_dedup_skip,    // Do not add near duplicates, clip_errcode_add_failed_near_duplicate is returned
+        clip_dedup_reuse,   // Add near duplicates with the feature of the image they match, without encoding
+    } clip_dedup_mode_e;
+
+    typedef struct
+    {
+        clip_dedup_mode_e mode;
+        int hamming_threshold; // Max Hamming distance between 64-bit dHash values to count as duplicate (default 5)
+        int history;           // Number of recently added images compared against (<= 0 uses 64)
+    } clip_dedup_config_t;
+
+    typedef struct
+    {
+        long long checked; // Images hashed by the gate
+        long long skipped; // Near duplicates that were not added
+        long long reused;  // Near duplicates added with a reused feature
+    } clip_dedup_stats_t;
+
+    typedef struct
+    {
+        long long hits;   // Text queries answered from the cache
+        long long misses; // Text queries that ran the text encoder
+        int size;         // Cached entries
+        int capacity;     // Max cached entries
+    } clip_text_cache_stats_t;
+
+    typedef struct
+    {
+        int devid;         // Device the image encoder instance is loaded on
+        char healthy;      // 0 once the instance failed and was taken out of rotation
+        int core_mask;     // NPU core mask the image encoder instance is pinned to (0 = engine default)
+        int inflight;      // Encodes currently dispatched to the instance
+        long long runs;    // Inferences completed
+        long long busy_us; // Time spent in inference
+        float utilization; // busy_us over the time since the instance was loaded
+    } clip_npu_core_stats_t;
+
+    typedef struct
+    {
+        float image_encoder_ms; // load_image_encoder (file check only with lazy_load)
+        float text_encoder_ms;  // load_text_encoder (file check only with lazy_load)
+        float tokenizer_ms;     // Tokenizer parse
+        float db_ms;            // Gallery db open and feature scan
+        float total_ms;         // clip_create wall time, below the sum of the stages with parallel_startup
+        char parallel;          // Stages ran concurrently
+    } clip_startup_stats_t;
+
+    typedef struct
+    {
+        int num_threads; // Image decode threads (<= 0 uses the number of CPU cores)
+        int queue_depth; // Max decoded images waiting for the encoder (<= 0 uses 2 * num_threads)
+        int batch_size;  // Max images per encode call (<= 0 uses 8)
+        char overwrite;  // Re-encode images whose key already exists instead of skipping them
+        void *userdata;  // Passed through to the progress callback
+    } clip_ingest_options_t;
+
+    /**
+     * @brief Per-file ingest callback, invoked from the calling thread of clip_ingest_paths
+     * @param path Image path
+     * @param key Image key (file name)
+     * @param status clip_errcode_success, clip_errcode_add_failed_key_exist when skipped, or another error code
+     * @param done Number of files finished so far
+     * @param total Number of files
+     * @param userdata clip_ingest_options_t::userdata
+     */
+    typedef void(CLIP_CALL *clip_ingest_progress_cb)(const char *path, const char *key, int status, int done, int total, void *userdata);
+
     /**
      * @brief Create CLIP handle
      * @param init_info Pointer to initialization information structure
@@ -153,6 +261,60 @@ extern "C"
      */
     CLIP_API int CLIP_CALL clip_add(clip_handle_t handle, char key[CLIP_KEY_MAX_LEN], clip_image_t *image, char overwrite);
 
+    /**
+     * @brief Add a batch of images to CLIP database
+     *        Images are packed into one NPU inference when the image encoder model has batch shape groups
+     * @param handle Handle
+     * @param keys Image keys, without overwrite a key repeated in the call fails with clip_errcode_add_failed_key_exist
+     * @param images Pointer to image structure array
+     * @param num Number of images
+     * @param overwrite Whether to overwrite
+     * @param status Per-image error code array of size num (optional, can be NULL), an invalid image
+     *               only fails its own entry
+     * @return clip_errcode_e Returns 0 on success, otherwise the first error code, see clip_errcode_e
+     */
+    CLIP_API int CLIP_CALL clip_add_batch(clip_handle_t handle, char keys[][CLIP_KEY_MAX_LEN], clip_image_t *images, int num, char overwrite, int *status);
+
+    /**
+     * @brief Add several regions of one image to CLIP database
+     *        Every region is cropped and resized straight from the shared source and encoded as one batch.
+     *        Region i is stored under the key "<key_prefix>#obj<i>", e.g. "frame42#obj3"
+     * @param handle Handle
+     * @param image Pointer to image structure
+     * @param rois Region array, clipped to the image bounds
+     * @param num Number of regions (> 0, otherwise clip_errcode_invalid_param)
+     * @param key_prefix Key prefix
+     * @param overwrite Whether to overwrite
+     * @return clip_errcode_e Returns 0 on success, error codes see clip_errcode_e
+     */
+    CLIP_API int CLIP_CALL clip_add_rois(clip_handle_t handle, clip_image_t *image, clip_rect_t *rois, int num, const char *key_prefix, char overwrite);
+
+    /**
+     * @brief Get image features of several regions of one image without adding them to the database
+     * @param handle Handle
+     * @param image Pointer to image structure
+     * @param rois Region array, clipped to the image bounds
+     * @param num Number of regions (> 0, otherwise clip_errcode_invalid_param)
+     * @param feats Feature structure array of size num
+     * @return clip_errcode_e Returns 0 on success, error codes see clip_errcode_e
+     */
+    CLIP_API int CLIP_CALL clip_get_image_feat_rois(clip_handle_t handle, clip_image_t *image, clip_rect_t *rois, int num, clip_feature_item_t *feats);
+
+    /**
+     * @brief Decode and add image files to CLIP database
+     *        A bounded pool of threads reads and decodes the files while the calling thread keeps the image encoder busy,
+     *        with several image encoder instances (replica or device pool mode) each instance gets its own feeder.
+     *        The file name is used as key, files whose key already exists are skipped unless options->overwrite is set.
+     *        JPEG files are decoded at the smallest DCT scale (1/2, 1/4, 1/8) that still covers the model input when built with libjpeg.
+     * @param handle Handle
+     * @param paths Image file paths, none of them NULL
+     * @param num Number of paths (> 0, otherwise clip_errcode_invalid_param)
+     * @param options Ingest options (optional, can be NULL)
+     * @param progress_cb Per-file status callback (optional, can be NULL)
+     * @return clip_errcode_e Returns 0 if every file was added or skipped, otherwise the first error code, see clip_errcode_e
+     */
+    CLIP_API int CLIP_CALL clip_ingest_paths(clip_handle_t handle, const char **paths, int num, clip_ingest_options_t *options, clip_ingest_progress_cb progress_cb);
+
     /**
      * @brief Remove image from CLIP database
      * @param handle Handle
@@ -172,6 +334,8 @@ extern "C"
     
     /**
      * @brief Get text feature
+     *        Results are kept in an LRU cache keyed by the whitespace-normalized text (see clip_init_t::text_cache_size),
+     *        and on disk when clip_init_t::text_cache_persist is set
      * @param handle Handle
      * @param text Text
      * @param feat Pointer to feature structure
@@ -180,6 +344,39 @@ extern "C"
     CLIP_API int CLIP_CALL clip_get_text_feat(clip_handle_t handle, const char *text, clip_feature_item_t *feat);
 
     
+    /**
+     * @brief Get text feature from token ids produced offline, the tokenizer is not used
+     * @param handle Handle
+     * @param ids Token ids including the special tokens the model's tokenizer adds
+     *            (e.g. <|startoftext|> ... <|endoftext|> for CLIP, ... <eos> for SigLIP2), without padding,
+     *            each in [0, vocab size) (otherwise clip_errcode_invalid_param)
+     * @param n_ids Number of ids, in [1, text encoder context length] (otherwise clip_errcode_invalid_param)
+     * @param feat Pointer to feature structure
+     * @return clip_errcode_e Returns 0 on success, error codes see clip_errcode_e
+     */
+    CLIP_API int CLIP_CALL clip_get_text_feat_from_ids(clip_handle_t handle, const int *ids, int n_ids, clip_feature_item_t *feat);
+
+    /**
+     * @brief Batched clip_get_text_feat_from_ids, sequences are packed into batch shape groups when the model has them
+     * @param handle Handle
+     * @param ids Token id array per text
+     * @param n_ids Number of ids per text, same bounds as in clip_get_text_feat_from_ids
+     * @param num Number of texts (> 0, otherwise clip_errcode_invalid_param)
+     * @param feats Feature structure array of size num
+     * @return clip_errcode_e Returns 0 on success, error codes see clip_errcode_e
+     */
+    CLIP_API int CLIP_CALL clip_get_text_feat_from_ids_batch(clip_handle_t handle, const int **ids, const int *n_ids, int num, clip_feature_item_t *feats);
+
+    /**
+     * @brief Encode a list of texts ahead of time so later clip_get_text_feat / clip_match_text calls hit the cache
+     *        Texts already cached (in memory or in the on-disk store) are not encoded again
+     * @param handle Handle
+     * @param texts Text array
+     * @param num Number of texts
+     * @return clip_errcode_e Returns 0 on success, error codes see clip_errcode_e
+     */
+    CLIP_API int CLIP_CALL clip_precompute_text_feats(clip_handle_t handle, const char **texts, int num);
+
     /**
      * @brief Feature match CLIP database images (cosine similarity)
      * @param handle Handle
@@ -210,6 +407,115 @@ extern "C"
      */
     CLIP_API int CLIP_CALL clip_match_image(clip_handle_t handle, clip_image_t *image, clip_result_item_t *results, int top_k);
 
+    /**
+     * @brief Create a zero-shot classifier over a fixed label set
+     *        Every label is encoded under each prompt template, the features are averaged and
+     *        normalized into one prototype per label
+     * @param handle Handle, must outlive the classifier
+     * @param labels Label array, results report labels truncated to CLIP_KEY_MAX_LEN - 1
+     * @param num Number of labels (> 0, otherwise clip_errcode_invalid_param)
+     * @param templates Prompt templates where "{}" is replaced by the label, e.g. "a photo of a {}."
+     *                  (NULL uses the label text as is)
+     * @param num_templates Number of templates
+     * @param classifier Classifier handle pointer
+     * @return clip_errcode_e Returns 0 on success, error codes see clip_errcode_e
+     */
+    CLIP_API int CLIP_CALL clip_classifier_create(clip_handle_t handle, const char **labels, int num, const char **templates, int num_templates, clip_classifier_t *classifier);
+
+    /**
+     * @brief Load a classifier written by clip_classifier_save
+     * @param handle Handle, must run the same model type and feature length the classifier was built with
+     * @param path Classifier file path
+     * @param classifier Classifier handle pointer
+     * @return clip_errcode_e Returns 0 on success, error codes see clip_errcode_e
+     */
+    CLIP_API int CLIP_CALL clip_classifier_load(clip_handle_t handle, const char *path, clip_classifier_t *classifier);
+
+    /**
+     * @brief Save a classifier so it can be reloaded without encoding the labels again
+     * @param classifier Classifier handle
+     * @param path Classifier file path
+     * @return clip_errcode_e Returns 0 on success, error codes see clip_errcode_e
+     */
+    CLIP_API int CLIP_CALL clip_classifier_save(clip_classifier_t classifier, const char *path);
+
+    /**
+     * @brief Destroy a classifier
+     * @param classifier Classifier handle
+     * @return clip_errcode_e Returns 0 on success, error codes see clip_errcode_e
+     */
+    CLIP_API int CLIP_CALL clip_classifier_destroy(clip_classifier_t classifier);
+
+    /**
+     * @brief Classify an image, scores are probabilities over the labels (softmax, or sigmoid for SigLIP2)
+     * @param classifier Classifier handle
+     * @param image Pointer to image structure
+     * @param results Pointer to result structure, key holds the label
+     * @param top_k Return top k results
+     * @return clip_errcode_e Returns 0 on success, error codes see clip_errcode_e
+     */
+    CLIP_API int CLIP_CALL clip_classify_image(clip_classifier_t classifier, clip_image_t *image, clip_result_item_t *results, int top_k);
+
+    /**
+     * @brief Classify an image feature (e.g. from clip_get_image_feat_rois)
+     * @param classifier Classifier handle
+     * @param feat Pointer to feature structure
+     * @param results Pointer to result structure, key holds the label
+     * @param top_k Return top k results
+     * @return clip_errcode_e Returns 0 on success, error codes see clip_errcode_e
+     */
+    CLIP_API int CLIP_CALL clip_classify_feat(clip_classifier_t classifier, clip_feature_item_t *feat, clip_result_item_t *results, int top_k);
+
+    /**
+     * @brief Get text feature cache statistics
+     * @param handle Handle
+     * @param stats Pointer to statistics structure
+     * @return clip_errcode_e Returns 0 on success, error codes see clip_errcode_e
+     */
+    CLIP_API int CLIP_CALL clip_get_text_cache_stats(clip_handle_t handle, clip_text_cache_stats_t *stats);
+
+    /**
+     * @brief Drop all cached text features, the hit/miss counters are kept
+     * @param handle Handle
+     * @return clip_errcode_e Returns 0 on success, error codes see clip_errcode_e
+     */
+    CLIP_API int CLIP_CALL clip_invalidate_text_cache(clip_handle_t handle);
+
+    /**
+     * @brief Get per-core counters of the image encoder, one entry per instance (one per core in replica mode)
+     * @param handle Handle
+     * @param stats Output array, may be NULL to only query the count
+     * @param num In: capacity of stats, out: number of instances
+     * @return clip_errcode_e Returns 0 on success, error codes see clip_errcode_e
+     */
+    CLIP_API int CLIP_CALL clip_get_npu_core_stats(clip_handle_t handle, clip_npu_core_stats_t *stats, int *num);
+
+    /**
+     * @brief Get the time clip_create spent in each startup stage
+     * @param handle Handle
+     * @param stats Pointer to statistics structure
+     * @return clip_errcode_e Returns 0 on success, error codes see clip_errcode_e
+     */
+    CLIP_API int CLIP_CALL clip_get_startup_stats(clip_handle_t handle, clip_startup_stats_t *stats);
+
+    /**
+     * @brief Configure the near-duplicate gate (disabled by default)
+     *        A 64-bit difference hash of a 9x8 downsample is compared against recently added images,
+     *        a match within the Hamming threshold skips the NPU encode
+     * @param handle Handle
+     * @param config Pointer to gate configuration
+     * @return clip_errcode_e Returns 0 on success, error codes see clip_errcode_e
+     */
+    CLIP_API int CLIP_CALL clip_set_dedup(clip_handle_t handle, clip_dedup_config_t *config);
+
+    /**
+     * @brief Get near-duplicate gate statistics
+     * @param handle Handle
+     * @param stats Pointer to statistics structure
+     * @return clip_errcode_e Returns 0 on success, error codes see clip_errcode_e
+     */
+    CLIP_API int CLIP_CALL clip_get_dedup_stats(clip_handle_t handle, clip_dedup_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -67,6 +67,7 @@ class AxDeviceType(ctypes.c_int):
     unknown_device = 0
     host_device = 1
     axcl_device = 2
+    mock_device = 3
 
 # 定义结构体
 class AxMemInfo(ctypes.Structure):
@@ -106,6 +107,9 @@ _lib.ax_dev_enum_devices.restype = ctypes.c_int
 _lib.ax_dev_sys_init.argtypes = [AxDeviceType, ctypes.c_char]
 _lib.ax_dev_sys_init.restype = ctypes.c_int
 
+_lib.ax_dev_sys_init_vnpu.argtypes = [AxDeviceType, ctypes.c_char, ctypes.c_int]
+_lib.ax_dev_sys_init_vnpu.restype = ctypes.c_int
+
 _lib.ax_dev_sys_deinit.argtypes = [AxDeviceType, ctypes.c_char]
 _lib.ax_dev_sys_deinit.restype = ctypes.c_int
 
@@ -139,8 +143,12 @@ def enum_devices() -> dict:
     }
 
 
-def sys_init(dev_type: AxDeviceType = AxDeviceType.axcl_device, devid: int = 0) -> None:
-    check_error(_lib.ax_dev_sys_init(dev_type, devid))
+def sys_init(dev_type: AxDeviceType = AxDeviceType.axcl_device, devid: int = 0, vnpu_mode: int = 0) -> None:
+    # vnpu_mode: 0 disable, 1 std, 2 big_little, 3 little_big
+    if vnpu_mode:
+        check_error(_lib.ax_dev_sys_init_vnpu(dev_type, devid, vnpu_mode))
+    else:
+        check_error(_lib.ax_dev_sys_init(dev_type, devid))
 
 
 def sys_deinit(dev_type: AxDeviceType = AxDeviceType.axcl_device, devid: int = 0) -> None:
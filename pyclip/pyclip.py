@@ -13,7 +13,20 @@ class ClipInit(ctypes.Structure):
         ('text_encoder_path', ctypes.c_char * 128),
         ('image_encoder_path', ctypes.c_char * 128),
         ('tokenizer_path', ctypes.c_char * 128),
-        ('db_path', ctypes.c_char * 128)
+        ('db_path', ctypes.c_char * 128),
+        ('model_type', ctypes.c_int),
+        ('text_cache_size', ctypes.c_int),
+        ('text_cache_persist', ctypes.c_char),
+        ('image_npu_affinity', ctypes.c_int),
+        ('text_npu_affinity', ctypes.c_int),
+        ('lazy_load', ctypes.c_char),
+        ('idle_unload_ms', ctypes.c_int),
+        ('image_io_slots', ctypes.c_int),
+        ('image_replica_cores', ctypes.c_int),
+        ('pool_num_devices', ctypes.c_int),
+        ('pool_devids', ctypes.c_ubyte * 8),
+        ('parallel_startup', ctypes.c_char),
+        ('io_pool_mb', ctypes.c_int)
     ]
 
 class ClipImage(ctypes.Structure):
@@ -79,6 +92,20 @@ class Clip:
         for path_name in ['text_encoder_path', 'image_encoder_path', 'tokenizer_path', 'db_path']:
             if path_name in init_info:
                 setattr(self.init_info, path_name, init_info[path_name].encode('utf-8'))
+
+        # 可选参数, 未设置时保持 0 即默认行为
+        for opt_name in ['model_type', 'text_cache_size', 'image_npu_affinity', 'text_npu_affinity', 'idle_unload_ms',
+                         'image_io_slots', 'image_replica_cores', 'io_pool_mb']:
+            if opt_name in init_info:
+                setattr(self.init_info, opt_name, int(init_info[opt_name]))
+        for flag_name in ['text_cache_persist', 'lazy_load', 'parallel_startup']:
+            if flag_name in init_info:
+                setattr(self.init_info, flag_name, 1 if init_info[flag_name] else 0)
+        if 'pool_devids' in init_info:
+            devids = list(init_info['pool_devids'])[:8]
+            self.init_info.pool_num_devices = len(devids)
+            for i, devid in enumerate(devids):
+                self.init_info.pool_devids[i] = devid
         
         # 创建CLIP实例
         handle = ctypes.c_void_p()
@@ -4,6 +4,13 @@
 #include <string>
 #include <fstream>
 #include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include "clip.h"
 #include "sample_log.h"
 
@@ -16,6 +23,101 @@ protected:
     std::shared_ptr<CLIPTextEncoder> m_text_encoder;
     std::shared_ptr<CLIPImageEncoder> m_image_encoder;
 
+    // one lane per encoder: text encodes are serialized (shared IO buffers), image encodes share the lane
+    // and are serialized by the runner's io slot pool instead; the exclusive image lane is only for (un)loading
+    std::mutex m_text_lane;
+    std::shared_mutex m_image_lane;
+
+    // lazy loading / idle eviction: encoders are (re)loaded from m_init_info on first use
+    clip_init_t m_init_info;
+    bool m_lazy_load = false;
+    int m_idle_unload_ms = 0;
+    std::atomic<int64_t> m_text_last_use{0};
+    std::atomic<int64_t> m_image_last_use{0};
+    std::thread m_evict_thread;
+    std::mutex m_evict_mutex;
+    std::condition_variable m_evict_cv;
+    bool m_evict_stop = false;
+
+    static int64_t now_ms()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // callers hold m_image_lane exclusively
+    bool ensure_image_encoder()
+    {
+        m_image_last_use = now_ms();
+        if (m_image_encoder->is_loaded())
+        {
+            return true;
+        }
+        ALOGI("loading image encoder %s", m_init_info.image_encoder_path);
+        return m_image_encoder->load_image_encoder(&m_init_info);
+    }
+
+    // take the image lane shared with the encoder loaded, loading it under the exclusive lane if needed
+    bool lock_image_encoder(std::shared_lock<std::shared_mutex> &lane)
+    {
+        lane = std::shared_lock<std::shared_mutex>(m_image_lane);
+        m_image_last_use = now_ms();
+        if (m_image_encoder->is_loaded())
+        {
+            return true;
+        }
+        lane.unlock();
+        {
+            std::unique_lock<std::shared_mutex> load_lane(m_image_lane);
+            if (!ensure_image_encoder())
+            {
+                return false;
+            }
+        }
+        lane.lock();
+        return m_image_encoder->is_loaded();
+    }
+
+    // callers hold m_text_lane
+    bool ensure_text_encoder()
+    {
+        m_text_last_use = now_ms();
+        if (m_text_encoder->is_loaded())
+        {
+            return true;
+        }
+        ALOGI("loading text encoder %s", m_init_info.text_encoder_path);
+        return m_text_encoder->load_text_encoder(&m_init_info);
+    }
+
+    // unload encoders idle for longer than m_idle_unload_ms; an encoder busy in its lane is skipped
+    void evict_loop()
+    {
+        auto period = std::chrono::milliseconds(std::max(10, std::min(m_idle_unload_ms / 4, 1000)));
+        std::unique_lock<std::mutex> lock(m_evict_mutex);
+        while (!m_evict_cv.wait_for(lock, period, [this]
+                                    { return m_evict_stop; }))
+        {
+            if (m_image_encoder)
+            {
+                std::unique_lock<std::shared_mutex> lane(m_image_lane, std::try_to_lock);
+                if (lane.owns_lock() && m_image_encoder->is_loaded() && now_ms() - m_image_last_use > m_idle_unload_ms)
+                {
+                    ALOGI("image encoder idle for %d ms, unloading", m_idle_unload_ms);
+                    m_image_encoder->unload_image_encoder();
+                }
+            }
+            if (m_text_encoder)
+            {
+                std::unique_lock<std::mutex> lane(m_text_lane, std::try_to_lock);
+                if (lane.owns_lock() && m_text_encoder->is_loaded() && now_ms() - m_text_last_use > m_idle_unload_ms)
+                {
+                    ALOGI("text encoder idle for %d ms, unloading", m_idle_unload_ms);
+                    m_text_encoder->unload_text_encoder();
+                }
+            }
+        }
+    }
+
     // SigLIP2 parameters from model
     float siglip2_logit_scale = 4.7244534f;
     float siglip2_logit_bias = -16.771725f;
@@ -135,6 +237,45 @@ protected:
 public:
     CLIP()
     {
+        memset(&m_init_info, 0, sizeof(m_init_info));
+    }
+
+    ~CLIP()
+    {
+        if (m_evict_thread.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_evict_mutex);
+                m_evict_stop = true;
+            }
+            m_evict_cv.notify_all();
+            m_evict_thread.join();
+        }
+    }
+
+    // must be called before load_image_encoder / load_text_encoder / load_tokenizer, which may then run on
+    // separate threads; init_info is kept for reloads
+    void set_load_policy(clip_init_t *init_info)
+    {
+        if (m_text_encoder == nullptr)
+        {
+            m_text_encoder.reset(new CLIPTextEncoderAX650);
+        }
+        if (m_image_encoder == nullptr)
+        {
+            m_image_encoder.reset(new CLIPImageEncoderAX650);
+        }
+        m_init_info = *init_info;
+        m_lazy_load = init_info->lazy_load != 0;
+        m_idle_unload_ms = std::max(init_info->idle_unload_ms, 0);
+    }
+
+    void start_idle_eviction()
+    {
+        if (m_idle_unload_ms > 0 && !m_evict_thread.joinable())
+        {
+            m_evict_thread = std::thread(&CLIP::evict_loop, this);
+        }
     }
 
     int get_image_feature_size()
@@ -144,9 +285,44 @@ public:
             ALOGE("image encoder is null");
             return -1;
         }
+        std::shared_lock<std::shared_mutex> lock;
+        if (!lock_image_encoder(lock))
+        {
+            return -1;
+        }
         return m_image_encoder->get_image_feature_size();
     }
 
+    // counters of the loaded image encoder instances, empty while it is unloaded
+    void get_image_core_stats(std::vector<clip_npu_core_stats_t> &stats)
+    {
+        stats.clear();
+        if (m_image_encoder == nullptr)
+        {
+            return;
+        }
+        std::shared_lock<std::shared_mutex> lock(m_image_lane);
+        if (m_image_encoder->is_loaded())
+        {
+            m_image_encoder->get_core_stats(stats);
+        }
+    }
+
+    // image encodes that can run in parallel, ingest keeps this many batches in flight
+    int get_image_instance_count()
+    {
+        if (m_image_encoder == nullptr)
+        {
+            return 1;
+        }
+        std::shared_lock<std::shared_mutex> lock;
+        if (!lock_image_encoder(lock))
+        {
+            return 1;
+        }
+        return std::max(1, m_image_encoder->get_instance_count());
+    }
+
     int get_text_feature_size()
     {
         if (m_text_encoder == nullptr)
@@ -154,9 +330,59 @@ public:
             ALOGE("text encoder is null");
             return -1;
         }
+        std::lock_guard<std::mutex> lock(m_text_lane);
+        if (!ensure_text_encoder())
+        {
+            return -1;
+        }
         return m_text_encoder->get_text_feature_size();
     }
 
+    int get_text_token_len()
+    {
+        if (m_text_encoder == nullptr)
+        {
+            ALOGE("text encoder is null");
+            return -1;
+        }
+        std::lock_guard<std::mutex> lock(m_text_lane);
+        if (!ensure_text_encoder())
+        {
+            return -1;
+        }
+        return m_text_encoder->get_text_token_len();
+    }
+
+    int get_image_input_width()
+    {
+        if (m_image_encoder == nullptr)
+        {
+            ALOGE("image encoder is null");
+            return -1;
+        }
+        std::shared_lock<std::shared_mutex> lock;
+        if (!lock_image_encoder(lock))
+        {
+            return -1;
+        }
+        return m_image_encoder->get_input_width();
+    }
+
+    int get_image_input_height()
+    {
+        if (m_image_encoder == nullptr)
+        {
+            ALOGE("image encoder is null");
+            return -1;
+        }
+        std::shared_lock<std::shared_mutex> lock;
+        if (!lock_image_encoder(lock))
+        {
+            return -1;
+        }
+        return m_image_encoder->get_input_height();
+    }
+
     bool load_tokenizer(std::string vocab_path, model_type_e model_type = model_type_unknown)
     {
         if (m_text_encoder == nullptr)
@@ -190,6 +416,19 @@ public:
         {
             m_text_encoder.reset(new CLIPTextEncoderAX650);
         }
+        if (m_lazy_load)
+        {
+            // only check the file here, the model is loaded by the first text encode
+            std::ifstream fs(init_info->text_encoder_path);
+            if (!fs.good())
+            {
+                ALOGE("text encoder open failed %s", init_info->text_encoder_path);
+                return false;
+            }
+            return true;
+        }
+        std::lock_guard<std::mutex> lock(m_text_lane);
+        m_text_last_use = now_ms();
         return m_text_encoder->load_text_encoder(init_info);
     }
 
@@ -199,6 +438,19 @@ public:
         {
             m_image_encoder.reset(new CLIPImageEncoderAX650);
         }
+        if (m_lazy_load)
+        {
+            // only check the file here, the model is loaded by the first image encode
+            std::ifstream fs(init_info->image_encoder_path);
+            if (!fs.good())
+            {
+                ALOGE("image encoder open failed %s", init_info->image_encoder_path);
+                return false;
+            }
+            return true;
+        }
+        std::unique_lock<std::shared_mutex> lock(m_image_lane);
+        m_image_last_use = now_ms();
         return m_image_encoder->load_image_encoder(init_info);
     }
 
@@ -209,6 +461,11 @@ public:
             ALOGE("image encoder is null");
             return false;
         }
+        std::shared_lock<std::shared_mutex> lock;
+        if (!lock_image_encoder(lock))
+        {
+            return false;
+        }
         auto ret = m_image_encoder->encode(image, image_features);
         return ret;
     }
@@ -220,21 +477,79 @@ public:
             ALOGE("image encoder is null");
             return false;
         }
+        std::shared_lock<std::shared_mutex> lock;
+        if (!lock_image_encoder(lock))
+        {
+            return false;
+        }
         auto ret = m_image_encoder->encode(image, image_features);
         return ret;
     }
 
+    bool encode(std::vector<SimpleCV::Mat> &images, std::vector<std::vector<float>> &image_features)
+    {
+        if (m_image_encoder == nullptr)
+        {
+            ALOGE("image encoder is null");
+            return false;
+        }
+        std::shared_lock<std::shared_mutex> lock;
+        if (!lock_image_encoder(lock))
+        {
+            return false;
+        }
+        auto ret = m_image_encoder->encode(images, image_features);
+        return ret;
+    }
+
+    bool encode(SimpleCV::Mat image, const std::vector<clip_rect_t> &rois, std::vector<std::vector<float>> &image_features)
+    {
+        if (m_image_encoder == nullptr)
+        {
+            ALOGE("image encoder is null");
+            return false;
+        }
+        std::shared_lock<std::shared_mutex> lock;
+        if (!lock_image_encoder(lock))
+        {
+            return false;
+        }
+        auto ret = m_image_encoder->encode(image, rois, image_features);
+        return ret;
+    }
+
     bool encode(std::vector<std::string> &texts, std::vector<std::vector<float>> &text_features)
     {
+        std::lock_guard<std::mutex> lock(m_text_lane);
         if (m_text_encoder == nullptr)
         {
             ALOGE("text encoder is null");
             return false;
         }
+        if (!ensure_text_encoder())
+        {
+            return false;
+        }
         auto ret = m_text_encoder->encode(texts, text_features);
         return ret;
     }
 
+    bool encode_ids(std::vector<std::vector<int>> &ids, std::vector<std::vector<float>> &text_features)
+    {
+        std::lock_guard<std::mutex> lock(m_text_lane);
+        if (m_text_encoder == nullptr)
+        {
+            ALOGE("text encoder is null");
+            return false;
+        }
+        if (!ensure_text_encoder())
+        {
+            return false;
+        }
+        auto ret = m_text_encoder->encode_ids(ids, text_features);
+        return ret;
+    }
+
     bool encode(std::string text, std::vector<float> &text_feature)
     {
         std::vector<std::vector<float>> text_features;
@@ -247,6 +562,46 @@ public:
         return ret;
     }
 
+    CLIPType get_clip_type()
+    {
+        if (m_text_encoder == nullptr)
+        {
+            return CLIPType::unknown;
+        }
+        return m_text_encoder->get_clip_type();
+    }
+
+    // only needs the tokenizer, the text model is not loaded for this
+    int get_vocab_size()
+    {
+        if (m_text_encoder == nullptr)
+        {
+            return 0;
+        }
+        return m_text_encoder->get_vocab_size();
+    }
+
+    // turn the cosine similarities of one image against N texts into probabilities over the texts,
+    // same scaling as decode(): sigmoid with scale/bias for SigLIP2, softmax over logit_scale * cos otherwise
+    void similarity_to_prob(std::vector<float> &similarity)
+    {
+        if (get_clip_type() == CLIPType::siglip2)
+        {
+            float scale = std::exp(siglip2_logit_scale);
+            for (auto &v : similarity)
+                v = sigmoid(v * scale + siglip2_logit_bias);
+        }
+        else if (!similarity.empty())
+        {
+            const float logit_scale = 100.0f;
+            for (auto &v : similarity)
+                v *= logit_scale;
+            std::vector<float> prob;
+            fast_softmax_row(similarity, prob);
+            similarity.swap(prob);
+        }
+    }
+
     void decode(std::vector<std::vector<float>> &image_features, std::vector<std::vector<float>> &text_features,
                 std::vector<std::vector<float>> &logits_per_image, std::vector<std::vector<float>> &logits_per_text)
     {
@@ -0,0 +1,187 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include "clip.h"
+#include "sample_log.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+// Zero-shot classifier: one L2-normalized prototype per label, packed row-major as [labels x dim]
+// so scoring an image is a single mat-vec over contiguous memory.
+class CLIPClassifier
+{
+private:
+    std::vector<std::string> m_labels;
+    std::vector<float> m_prototypes;
+    int m_dim = 0;
+    int m_clip_type = 0;
+
+    static constexpr char MAGIC[8] = {'C', 'L', 'I', 'P', 'C', 'L', 'S', '1'};
+
+    static float dot(const float *a, const float *b, int n)
+    {
+        int i = 0;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+        float32x4_t acc0 = vdupq_n_f32(0.f);
+        float32x4_t acc1 = vdupq_n_f32(0.f);
+        for (; i + 8 <= n; i += 8)
+        {
+            acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+            acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+        }
+        float32x4_t acc = vaddq_f32(acc0, acc1);
+        float sum = vgetq_lane_f32(acc, 0) + vgetq_lane_f32(acc, 1) + vgetq_lane_f32(acc, 2) + vgetq_lane_f32(acc, 3);
+#else
+        // four independent accumulators so the compiler can vectorize without -ffast-math
+        float s0 = 0.f, s1 = 0.f, s2 = 0.f, s3 = 0.f;
+        for (; i + 4 <= n; i += 4)
+        {
+            s0 += a[i] * b[i];
+            s1 += a[i + 1] * b[i + 1];
+            s2 += a[i + 2] * b[i + 2];
+            s3 += a[i + 3] * b[i + 3];
+        }
+        float sum = (s0 + s1) + (s2 + s3);
+#endif
+        for (; i < n; i++)
+            sum += a[i] * b[i];
+        return sum;
+    }
+
+    static void normalize(float *v, int n)
+    {
+        float norm = std::sqrt(dot(v, v, n));
+        if (norm > 0.f)
+        {
+            for (int i = 0; i < n; i++)
+                v[i] /= norm;
+        }
+    }
+
+public:
+    // features holds num_templates consecutive text features per label
+    bool build(const std::vector<std::string> &labels, const std::vector<std::vector<float>> &features, int num_templates, int clip_type)
+    {
+        if (labels.empty() || num_templates <= 0 || features.size() != labels.size() * num_templates)
+        {
+            ALOGE("classifier build failed, labels %d templates %d features %d", (int)labels.size(), num_templates, (int)features.size());
+            return false;
+        }
+        m_dim = features[0].size();
+        m_labels = labels;
+        m_clip_type = clip_type;
+        m_prototypes.assign(labels.size() * m_dim, 0.f);
+        for (size_t l = 0; l < labels.size(); l++)
+        {
+            float *proto = m_prototypes.data() + l * m_dim;
+            for (int t = 0; t < num_templates; t++)
+            {
+                auto &feat = features[l * num_templates + t];
+                if ((int)feat.size() != m_dim)
+                {
+                    ALOGE("classifier build failed, feature len %d != %d", (int)feat.size(), m_dim);
+                    return false;
+                }
+                for (int i = 0; i < m_dim; i++)
+                    proto[i] += feat[i];
+            }
+            normalize(proto, m_dim);
+        }
+        return true;
+    }
+
+    // cosine similarity of a normalized feature against every label
+    void similarity(const float *feat, std::vector<float> &scores) const
+    {
+        scores.resize(m_labels.size());
+        for (size_t l = 0; l < m_labels.size(); l++)
+        {
+            scores[l] = dot(m_prototypes.data() + l * m_dim, feat, m_dim);
+        }
+    }
+
+    int get_dim() const { return m_dim; }
+    int get_clip_type() const { return m_clip_type; }
+    const std::vector<std::string> &get_labels() const { return m_labels; }
+
+    bool save(const std::string &path) const
+    {
+        std::ofstream ofs(path, std::ios::binary);
+        if (!ofs.good())
+        {
+            ALOGE("classifier save failed, open %s", path.c_str());
+            return false;
+        }
+        uint32_t header[3] = {(uint32_t)m_clip_type, (uint32_t)m_labels.size(), (uint32_t)m_dim};
+        ofs.write(MAGIC, sizeof(MAGIC));
+        ofs.write((const char *)header, sizeof(header));
+        for (auto &label : m_labels)
+        {
+            uint32_t len = label.size();
+            ofs.write((const char *)&len, sizeof(len));
+            ofs.write(label.data(), len);
+        }
+        ofs.write((const char *)m_prototypes.data(), m_prototypes.size() * sizeof(float));
+        return ofs.good();
+    }
+
+    bool load(const std::string &path)
+    {
+        std::ifstream ifs(path, std::ios::binary);
+        if (!ifs.good())
+        {
+            ALOGE("classifier load failed, open %s", path.c_str());
+            return false;
+        }
+        char magic[sizeof(MAGIC)];
+        uint32_t header[3];
+        ifs.read(magic, sizeof(magic));
+        ifs.read((char *)header, sizeof(header));
+        if (!ifs.good() || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || header[2] == 0 || header[2] > CLIP_TEXT_FEAT_MAX_LEN)
+        {
+            ALOGE("classifier load failed, %s is not a classifier file", path.c_str());
+            return false;
+        }
+        // every label takes at least its length field, so a count larger than the file can hold is corrupt
+        std::streamoff header_end = ifs.tellg();
+        ifs.seekg(0, std::ios::end);
+        uint64_t remaining = (uint64_t)(ifs.tellg() - header_end);
+        ifs.seekg(header_end);
+        if ((uint64_t)header[1] * (sizeof(uint32_t) + (uint64_t)header[2] * sizeof(float)) > remaining)
+        {
+            ALOGE("classifier load failed, %u labels x %u dims do not fit in %s", header[1], header[2], path.c_str());
+            return false;
+        }
+        std::vector<std::string> labels(header[1]);
+        for (auto &label : labels)
+        {
+            uint32_t len = 0;
+            ifs.read((char *)&len, sizeof(len));
+            if (!ifs.good() || len > 4096)
+            {
+                ALOGE("classifier load failed, corrupt label table in %s", path.c_str());
+                return false;
+            }
+            label.resize(len);
+            ifs.read(&label[0], len);
+        }
+        std::vector<float> prototypes((size_t)header[1] * header[2]);
+        ifs.read((char *)prototypes.data(), prototypes.size() * sizeof(float));
+        if (!ifs.good())
+        {
+            ALOGE("classifier load failed, truncated %s", path.c_str());
+            return false;
+        }
+        m_clip_type = header[0];
+        m_dim = header[2];
+        m_labels.swap(labels);
+        m_prototypes.swap(prototypes);
+        return true;
+    }
+};
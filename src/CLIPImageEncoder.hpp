@@ -2,6 +2,7 @@
 // #include <opencv2/opencv.hpp>
 #include <SimpleCV.hpp>
 #include <memory>
+#include <algorithm>
 #include "clip.h"
 #include "sample_log.h"
 
@@ -31,16 +32,82 @@ protected:
     int LEN_IMAGE_FEATURE = 512;
     int input_height, input_width;
 
+    static bool to_bgr(SimpleCV::Mat &image, SimpleCV::Mat &cv_image_input)
+    {
+        switch (image.channels)
+        {
+        case 4:
+            cv_image_input = SimpleCV::cvtColor(image, SimpleCV::ColorSpace::BGRA, SimpleCV::ColorSpace::BGR);
+            break;
+        case 1:
+            cv_image_input = SimpleCV::cvtColor(image, SimpleCV::ColorSpace::GRAY, SimpleCV::ColorSpace::BGR);
+            break;
+        case 3:
+            cv_image_input = image;
+            break;
+        default:
+            ALOGE("only support channel 1,3,4 uint8 image");
+            return false;
+        }
+        return true;
+    }
+
 public:
     virtual bool load_image_encoder(clip_init_t *clip_init) = 0;
+    // release the model and its IO buffers, load_image_encoder() brings it back
+    virtual void unload_image_encoder() = 0;
+    virtual bool is_loaded() = 0;
+    virtual void get_core_stats(std::vector<clip_npu_core_stats_t> &stats) { stats.clear(); }
+    // loaded model instances that can encode in parallel (replicas, pooled devices)
+    virtual int get_instance_count() { return 1; }
     virtual bool encode(SimpleCV::Mat image, std::vector<float> &image_features) = 0;
     virtual bool encode(clip_image_t *image, std::vector<float> &image_features) = 0;
+    // Encode several images, packing them into the model's batch dimension when available
+    virtual bool encode(std::vector<SimpleCV::Mat> &images, std::vector<std::vector<float>> &image_features) = 0;
+
+    // Encode several regions of one image. The channel conversion is done once for the whole image,
+    // each region is a view into it, so it is only touched again by the resize to the model input.
+    bool encode(SimpleCV::Mat image, const std::vector<clip_rect_t> &rois, std::vector<std::vector<float>> &image_features)
+    {
+        SimpleCV::Mat bgr;
+        if (!to_bgr(image, bgr))
+        {
+            return false;
+        }
+
+        std::vector<SimpleCV::Mat> crops;
+        crops.reserve(rois.size());
+        for (auto &roi : rois)
+        {
+            int x0 = std::max(roi.x, 0);
+            int y0 = std::max(roi.y, 0);
+            int x1 = std::min(roi.x + roi.width, bgr.width);
+            int y1 = std::min(roi.y + roi.height, bgr.height);
+            if (x1 <= x0 || y1 <= y0)
+            {
+                ALOGE("roi [%d %d %d %d] is outside the %dx%d image", roi.x, roi.y, roi.width, roi.height, bgr.width, bgr.height);
+                return false;
+            }
+            crops.emplace_back(y1 - y0, x1 - x0, 3, bgr.data + (size_t)y0 * bgr.step + x0 * 3, bgr.step);
+        }
+        return encode(crops, image_features);
+    }
 
     int get_image_feature_size()
     {
         return LEN_IMAGE_FEATURE;
     }
 
+    int get_input_width()
+    {
+        return input_width;
+    }
+
+    int get_input_height()
+    {
+        return input_height;
+    }
+
     // Set preprocessing parameters
     void set_preprocess_params(const ImagePreprocessParams &params)
     {
@@ -2,46 +2,472 @@
 #include "CLIPImageEncoder.hpp"
 #include "runner/ax650/ax_model_runner_ax650.hpp"
 #include "runner/axcl/ax_model_runner_axcl.hpp"
+#include "runner/mock/ax_model_runner_mock.hpp"
+#include "runner/ax_model_registry.hpp"
 #include "mmap.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <deque>
+
 class CLIPImageEncoderAX650 : public CLIPImageEncoder
 {
 private:
+    // one loaded copy of the model on a device, pinned to an NPU core mask, with its own counters
+    struct replica_t
+    {
+        std::shared_ptr<ax_runner_base> runner;
+        int devid = 0;
+        int core_mask = 0;
+        std::atomic<bool> healthy{true};
+        std::atomic<long long> errors{0};
+        std::atomic<int> inflight{0};
+        std::atomic<long long> runs{0};
+        std::atomic<long long> busy_us{0};
+        std::chrono::steady_clock::time_point loaded_at;
+    };
+    std::vector<std::unique_ptr<replica_t>> m_replicas;
+    std::mutex m_sched_mutex;
+
+    // replica 0, used for the model's shapes
     std::shared_ptr<ax_runner_base> m_encoder;
-    SimpleCV::Mat input;
 
     bool nchw;
 
-public:
-    bool load_image_encoder(clip_init_t *init_info) override
+    // (batch size, group id), sorted by batch size ascending
+    std::vector<std::pair<int, int>> m_batch_groups;
+
+    // resize + normalize one image into the io slot's input tensor at the given batch index
+    bool preprocess(ax_runner_base &runner, SimpleCV::Mat &image, int slot, int grpid, int batch_idx)
     {
-        // m_encoder.reset(new ax_runner_ax650);
-        // m_encoder->init(encoder_path.c_str());
+        SimpleCV::Mat cv_image_input, input;
+        if (!to_bgr(image, cv_image_input))
+        {
+            return false;
+        }
 
-        MMap image_mmap(init_info->image_encoder_path);
+        // images decoded by the ingest workers are already at model resolution
+        if (cv_image_input.width == input_width && cv_image_input.height == input_height && cv_image_input.step == input_width * 3)
+        {
+            input = cv_image_input;
+        }
+        else
+        {
+            SimpleCV::resize(cv_image_input, input, input_width, input_height);
+        }
 
-        if (init_info->dev_type == ax_devive_e::host_device)
+        int plane = input_width * input_height * 3;
+        if (nchw)
         {
+            float *inputPtr = (float *)runner.get_slot_input(slot, grpid, 0).pVirAddr + batch_idx * plane;
 
-            m_encoder = std::make_shared<ax_runner_ax650>();
-            auto ret = m_encoder->init(image_mmap.data(), image_mmap.size(), -1);
-            if (ret != 0)
+            unsigned char *img_data = input.data;
+
+            int letterbox_cols = input_width;
+            int letterbox_rows = input_height;
+            for (int c = 0; c < 3; c++)
+            {
+                for (int h = 0; h < letterbox_rows; h++)
+                {
+                    for (int w = 0; w < letterbox_cols; w++)
+                    {
+                        int in_index = h * letterbox_cols * 3 + w * 3 + c;
+                        int out_index = c * letterbox_rows * letterbox_cols + h * letterbox_cols + w;
+                        inputPtr[out_index] = (float(img_data[in_index]) - _mean_val[c]) * _std_val[c];
+                    }
+                }
+            }
+        }
+        else
+        {
+            unsigned char *inputPtr = (unsigned char *)runner.get_slot_input(slot, grpid, 0).pVirAddr + batch_idx * plane;
+            memcpy(inputPtr, input.data, plane);
+        }
+        return true;
+    }
+
+    void postprocess(ax_runner_base &runner, int slot, int grpid, int batch_idx, std::vector<float> &image_features)
+    {
+        image_features.resize(LEN_IMAGE_FEATURE);
+        // m_encoder->mem_sync_output(0);
+        float *outputPtr = (float *)runner.get_slot_output(slot, grpid, 0).pVirAddr + batch_idx * LEN_IMAGE_FEATURE;
+        memcpy(image_features.data(), outputPtr, LEN_IMAGE_FEATURE * sizeof(float));
+
+        float norm = 0.0f;
+        for (float v : image_features)
+            norm += v * v;
+        norm = std::sqrt(norm);
+        for (float &v : image_features)
+            v /= norm;
+    }
+
+    // largest group that fits the remaining images, or the smallest one if none fits
+    int select_batch_group(int remain)
+    {
+        int idx = 0;
+        for (size_t i = 0; i < m_batch_groups.size(); i++)
+        {
+            if (m_batch_groups[i].first <= remain)
             {
-                printf("text encoder init failed\n");
+                idx = i;
+            }
+        }
+        return idx;
+    }
+
+    int run(replica_t &replica, int slot, int grpid)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        auto &runner = *replica.runner;
+        int ret = grpid == 0 && slot == 0 ? runner.inference() : runner.inference(grpid, slot);
+        replica.busy_us += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+        replica.runs++;
+        if (ret != 0)
+        {
+            replica.errors++;
+        }
+        return ret;
+    }
 
+    // least-loaded healthy replica by encodes in flight (queue depth), ties go to the one that has run least
+    replica_t *acquire_replica()
+    {
+        std::lock_guard<std::mutex> lock(m_sched_mutex);
+        replica_t *best = nullptr;
+        for (auto &r : m_replicas)
+        {
+            if (!r->healthy)
+            {
+                continue;
+            }
+            if (best == nullptr)
+            {
+                best = r.get();
+                continue;
+            }
+            int inflight = r->inflight, best_inflight = best->inflight;
+            if (inflight < best_inflight || (inflight == best_inflight && r->runs < best->runs))
+            {
+                best = r.get();
+            }
+        }
+        if (best)
+        {
+            best->inflight++;
+        }
+        return best;
+    }
+
+    // Run fn(replica, slot, device_error) on the least-loaded replica. When it fails because the device did
+    // (fn set device_error on a failed run / submit / wait) that replica leaves the rotation and the encode
+    // is retried on another one; the last healthy replica is never taken out.
+    template <typename F>
+    bool dispatch(F &&fn)
+    {
+        for (size_t attempt = 0; attempt < m_replicas.size(); attempt++)
+        {
+            replica_t *replica = acquire_replica();
+            if (replica == nullptr)
+            {
+                ALOGE("no healthy image encoder instance");
                 return false;
             }
+            bool device_error = false;
+            int slot = replica->runner->acquire_slot();
+            bool ret = fn(*replica, slot, device_error);
+            replica->runner->release_slot(slot);
+            replica->inflight--;
+            if (ret)
+            {
+                return true;
+            }
+            if (!device_error)
+            {
+                return false; // the input was rejected, another device would not do better
+            }
+            {
+                // counted and flipped together, so concurrent failures cannot take out the last healthy replica
+                std::lock_guard<std::mutex> lock(m_sched_mutex);
+                int healthy = std::count_if(m_replicas.begin(), m_replicas.end(), [](const std::unique_ptr<replica_t> &r)
+                                            { return (bool)r->healthy; });
+                if (healthy <= 1 && replica->healthy)
+                {
+                    return false;
+                }
+                if (replica->healthy)
+                {
+                    ALOGE("image encoder on device %d core 0x%x failed, taking it out of rotation", replica->devid, replica->core_mask);
+                    replica->healthy = false;
+                }
+            }
         }
-        else if (init_info->dev_type == ax_devive_e::axcl_device)
+        return false;
+    }
+
+    // runners come from the process-wide registry, handles loading the same model with the same settings share one
+    std::shared_ptr<ax_runner_base> create_runner(clip_init_t *init_info, int devid, int npu_affinity)
+    {
+        int num_slots = std::max(1, init_info->image_io_slots);
+        auto key = ax_model_registry::make_key(init_info->image_encoder_path, init_info->dev_type,
+                                               init_info->dev_type == ax_devive_e::axcl_device ? devid : -1,
+                                               "slots=" + std::to_string(num_slots) + ",affinity=" + std::to_string(npu_affinity));
+        return ax_model_registry::instance().acquire(key, [&]() -> ax_runner_base *
+                                                      {
+            ax_runner_base *runner = nullptr;
+            if (init_info->dev_type == ax_devive_e::host_device)
+            {
+                runner = new ax_runner_ax650;
+                devid = -1;
+            }
+            else if (init_info->dev_type == ax_devive_e::axcl_device)
+            {
+                runner = new ax_runner_axcl;
+            }
+            else if (init_info->dev_type == ax_devive_e::mock_device)
+            {
+                runner = new ax_runner_mock;
+                devid = -1;
+            }
+            else
+            {
+                return nullptr;
+            }
+            std::string model_path = init_info->image_encoder_path;
+            if (init_info->dev_type == ax_devive_e::mock_device)
+            {
+                model_path = ax_runner_mock::spec_path(model_path);
+            }
+            MMap image_mmap(model_path.c_str());
+            runner->set_num_io_slots(num_slots);
+            runner->set_io_pool_size((size_t)std::max(init_info->io_pool_mb, 0) << 20);
+            int ret = runner->init(image_mmap.data(), image_mmap.size(), devid);
+            if (ret != 0)
+            {
+                printf("image encoder init failed on device %d\n", devid);
+                // init may have created some contexts and io buffers before failing
+                runner->deinit();
+                delete runner;
+                return nullptr;
+            }
+            if (npu_affinity != 0)
+            {
+                // pin to dedicated NPU cores so the other encoder's lane does not queue behind this one
+                ret = runner->set_affinity(npu_affinity);
+                if (ret != 0)
+                {
+                    ALOGW("image encoder set affinity 0x%x failed, ret=%d", npu_affinity, ret);
+                }
+            }
+            return runner; });
+    }
+
+    bool encode_on_slot(replica_t &replica, int slot, SimpleCV::Mat &image, std::vector<float> &image_features, bool &device_error)
+    {
+        int grpid = m_batch_groups[0].second;
+        if (!preprocess(*replica.runner, image, slot, grpid, 0))
         {
-            m_encoder = std::make_shared<ax_runner_axcl>();
-            auto ret = m_encoder->init(image_mmap.data(), image_mmap.size(), init_info->devid);
+            return false;
+        }
+        replica.runner->set_valid_batch(slot, grpid, 1);
+
+        auto ret = run(replica, slot, grpid);
+        if (ret != 0)
+        {
+            ALOGE("image encoder inference failed, ret=%d", ret);
+            device_error = true;
+            return false;
+        }
+
+        postprocess(*replica.runner, slot, grpid, 0, image_features);
+        return true;
+    }
+
+    bool encode_on_slot(replica_t &replica, int slot, std::vector<SimpleCV::Mat> &images, std::vector<std::vector<float>> &image_features,
+                        bool &device_error)
+    {
+        image_features.resize(images.size());
+        size_t offset = 0;
+        while (offset < images.size())
+        {
+            int remain = images.size() - offset;
+            auto &bg = m_batch_groups[select_batch_group(remain)];
+            int batch = bg.first;
+            int grpid = bg.second;
+            int count = std::min(batch, remain);
+
+            for (int b = 0; b < count; b++)
+            {
+                if (!preprocess(*replica.runner, images[offset + b], slot, grpid, b))
+                {
+                    return false;
+                }
+            }
+            // a partly filled batch only moves the images it holds over PCIe
+            replica.runner->set_valid_batch(slot, grpid, count);
+
+            auto ret = run(replica, slot, grpid);
             if (ret != 0)
             {
-                printf("text encoder init failed\n");
+                ALOGE("image encoder inference failed, grpid=%d ret=%d", grpid, ret);
+                device_error = true;
                 return false;
             }
+
+            for (int b = 0; b < count; b++)
+            {
+                postprocess(*replica.runner, slot, grpid, b, image_features[offset + b]);
+            }
+            offset += count;
+        }
+        return true;
+    }
+
+    // Two io slots in flight: while the NPU runs one chunk the next is preprocessed and submitted
+    // into the other slot, on AXCL its upload also overlaps the execute and the previous download.
+    bool encode_pipelined(replica_t &replica, const int slots[2], std::vector<SimpleCV::Mat> &images, std::vector<std::vector<float>> &image_features,
+                          bool &device_error)
+    {
+        struct chunk_t
+        {
+            int slot, grpid, offset, count, ticket;
+            std::chrono::steady_clock::time_point submitted;
+        };
+        std::deque<chunk_t> inflight;
+        auto &runner = *replica.runner;
+        auto last_done = std::chrono::steady_clock::now();
+        bool ok = true;
+
+        image_features.resize(images.size());
+        size_t offset = 0;
+        int next = 0;
+        while (ok && (offset < images.size() || !inflight.empty()))
+        {
+            if (offset < images.size() && inflight.size() < 2)
+            {
+                int remain = images.size() - offset;
+                auto &bg = m_batch_groups[select_batch_group(remain)];
+                chunk_t c;
+                c.slot = slots[next];
+                c.grpid = bg.second;
+                c.offset = offset;
+                c.count = std::min(bg.first, remain);
+                next ^= 1;
+
+                for (int b = 0; b < c.count && ok; b++)
+                {
+                    ok = preprocess(runner, images[offset + b], c.slot, c.grpid, b);
+                }
+                if (!ok)
+                {
+                    break;
+                }
+                runner.set_valid_batch(c.slot, c.grpid, c.count);
+                c.submitted = std::chrono::steady_clock::now();
+                c.ticket = runner.submit(c.grpid, c.slot);
+                if (c.ticket < 0)
+                {
+                    ALOGE("image encoder submit failed, grpid=%d", c.grpid);
+                    replica.errors++;
+                    device_error = true;
+                    ok = false;
+                    break;
+                }
+                inflight.push_back(c);
+                offset += c.count;
+                continue;
+            }
+
+            auto c = inflight.front();
+            inflight.pop_front();
+            auto ret = runner.wait(c.ticket);
+            // the NPU runs one chunk at a time, so only count time not already spent on the previous chunk
+            auto done = std::chrono::steady_clock::now();
+            replica.busy_us += std::chrono::duration_cast<std::chrono::microseconds>(done - std::max(c.submitted, last_done)).count();
+            replica.runs++;
+            last_done = done;
+            if (ret != 0)
+            {
+                ALOGE("image encoder inference failed, grpid=%d ret=%d", c.grpid, ret);
+                replica.errors++;
+                device_error = true;
+                ok = false;
+                break;
+            }
+            for (int b = 0; b < c.count; b++)
+            {
+                postprocess(runner, c.slot, c.grpid, b, image_features[c.offset + b]);
+            }
+        }
+
+        // the slots go back to the pool, nothing may still be writing into them
+        for (auto &c : inflight)
+        {
+            runner.wait(c.ticket);
         }
+        return ok;
+    }
+
+public:
+    bool load_image_encoder(clip_init_t *init_info) override
+    {
+        // m_encoder.reset(new ax_runner_ax650);
+        // m_encoder->init(encoder_path.c_str());
+
+        // pool mode: one set of replicas per listed AXCL card, otherwise just devid
+        std::vector<int> devids;
+        if (init_info->dev_type == ax_devive_e::axcl_device)
+        {
+            for (int i = 0; i < std::min(init_info->pool_num_devices, CLIP_MAX_POOL_DEVICES); i++)
+            {
+                devids.push_back(init_info->pool_devids[i]);
+            }
+        }
+        if (devids.empty())
+        {
+            devids.push_back(init_info->devid);
+        }
+
+        // replica mode: one copy of the model per core in image_replica_cores, otherwise a single instance
+        std::vector<int> masks;
+        for (int core = 0; core < 31; core++)
+        {
+            if (init_info->image_replica_cores & (1 << core))
+            {
+                masks.push_back(1 << core);
+            }
+        }
+        if (masks.empty())
+        {
+            masks.push_back(init_info->image_npu_affinity);
+        }
+
+        m_replicas.clear();
+        for (int devid : devids)
+        {
+            for (int mask : masks)
+            {
+                auto runner = create_runner(init_info, devid, mask);
+                if (!runner)
+                {
+                    unload_image_encoder();
+                    return false;
+                }
+                std::unique_ptr<replica_t> replica(new replica_t);
+                replica->runner = runner;
+                replica->devid = devid;
+                replica->core_mask = mask;
+                replica->loaded_at = std::chrono::steady_clock::now();
+                m_replicas.push_back(std::move(replica));
+            }
+        }
+        if (m_replicas.size() > 1)
+        {
+            ALOGI("image encoder replicas %d on %d devices", (int)m_replicas.size(), (int)devids.size());
+        }
+        m_encoder = m_replicas[0]->runner;
+
         nchw = m_encoder->get_input(0).vShape[1] == 3;
         if (nchw)
         {
@@ -58,31 +484,62 @@ public:
 
         LEN_IMAGE_FEATURE = m_encoder->get_output(0).vShape[1];
         ALOGI("image feature len %d", LEN_IMAGE_FEATURE);
+
+        // each shape group compiled with a different leading batch dim is usable for batch inference
+        m_batch_groups.clear();
+        for (int grpid = 0; grpid < m_encoder->get_num_input_groups(); grpid++)
+        {
+            auto &in_shape = m_encoder->get_input(grpid, 0).vShape;
+            auto &out_shape = m_encoder->get_output(grpid, 0).vShape;
+            if (in_shape.size() != 4 || out_shape.size() < 2 || in_shape[0] != out_shape[0])
+            {
+                continue;
+            }
+            int in_h = nchw ? in_shape[2] : in_shape[1];
+            int in_w = nchw ? in_shape[3] : in_shape[2];
+            if (in_h != input_height || in_w != input_width || (int)out_shape[out_shape.size() - 1] != LEN_IMAGE_FEATURE)
+            {
+                continue;
+            }
+            m_batch_groups.push_back({(int)in_shape[0], grpid});
+        }
+        if (m_batch_groups.empty())
+        {
+            m_batch_groups.push_back({1, 0});
+        }
+        std::stable_sort(m_batch_groups.begin(), m_batch_groups.end());
+        for (auto &bg : m_batch_groups)
+        {
+            ALOGI("image encoder group %d batch %d", bg.second, bg.first);
+        }
         return true;
     }
 
+    // drops this encoder's references, the registry deinits a runner once no handle uses it
+    void unload_image_encoder() override
+    {
+        m_replicas.clear();
+        m_encoder.reset();
+    }
+
+    bool is_loaded() override
+    {
+        return m_encoder != nullptr;
+    }
+
+    int get_instance_count() override
+    {
+        return m_replicas.size();
+    }
+
     bool encode(clip_image_t *image, std::vector<float> &image_features) override
     {
         SimpleCV::Mat cv_image(image->height, image->width, image->channels, image->data, image->stride);
-        SimpleCV::Mat cv_image_input;
-        switch (image->channels)
-        {
-        case 4:
-            cv_image_input = SimpleCV::cvtColor(cv_image, SimpleCV::ColorSpace::BGRA, SimpleCV::ColorSpace::BGR);
-            break;
-        case 1:
-            cv_image_input = SimpleCV::cvtColor(cv_image, SimpleCV::ColorSpace::GRAY, SimpleCV::ColorSpace::BGR);
-            break;
-        case 3:
-            cv_image_input = cv_image;
-            break;
-        default:
-            ALOGE("only support channel 1,3,4 uint8 image");
-            return false;
-        }
         return encode(cv_image, image_features);
     }
 
+    // concurrent callers go to the least-loaded replica and take one of its io slots,
+    // once every slot is busy they queue up in acquire_slot()
     bool encode(SimpleCV::Mat image, std::vector<float> &image_features) override
     {
         if (!m_encoder.get())
@@ -90,65 +547,49 @@ public:
             ALOGE("encoder not init");
             return false;
         }
-        SimpleCV::Mat cv_image_input;
-        switch (image.channels)
-        {
-        case 4:
-            cv_image_input = SimpleCV::cvtColor(image, SimpleCV::ColorSpace::BGRA, SimpleCV::ColorSpace::BGR);
-            break;
-        case 1:
-            cv_image_input = SimpleCV::cvtColor(image, SimpleCV::ColorSpace::GRAY, SimpleCV::ColorSpace::BGR);
-            break;
-        case 3:
-            cv_image_input = image;
-            break;
-        default:
-            ALOGE("only support channel 1,3,4 uint8 image");
-            return false;
-        }
 
-        SimpleCV::resize(cv_image_input, input, input_width, input_height);
+        return dispatch([&](replica_t &replica, int slot, bool &device_error)
+                        { return encode_on_slot(replica, slot, image, image_features, device_error); });
+    }
 
-        if (nchw)
+    bool encode(std::vector<SimpleCV::Mat> &images, std::vector<std::vector<float>> &image_features) override
+    {
+        if (!m_encoder.get())
         {
-            float *inputPtr = (float *)m_encoder->get_input(0).pVirAddr;
-
-            unsigned char *img_data = input.data;
+            ALOGE("encoder not init");
+            return false;
+        }
 
-            int letterbox_cols = input_width;
-            int letterbox_rows = input_height;
-            for (int c = 0; c < 3; c++)
+        return dispatch([&](replica_t &replica, int slot, bool &device_error)
+                        {
+            // pipeline over a second slot when the batch spans several runs and one is free right now
+            int second = images.size() > (size_t)m_batch_groups.back().first ? replica.runner->try_acquire_slot() : -1;
+            if (second < 0)
             {
-                for (int h = 0; h < letterbox_rows; h++)
-                {
-                    for (int w = 0; w < letterbox_cols; w++)
-                    {
-                        int in_index = h * letterbox_cols * 3 + w * 3 + c;
-                        int out_index = c * letterbox_rows * letterbox_cols + h * letterbox_cols + w;
-                        inputPtr[out_index] = (float(img_data[in_index]) - _mean_val[c]) * _std_val[c];
-                    }
-                }
+                return encode_on_slot(replica, slot, images, image_features, device_error);
             }
-        }
-        else
+            int slots[2] = {slot, second};
+            bool ret = encode_pipelined(replica, slots, images, image_features, device_error);
+            replica.runner->release_slot(second);
+            return ret; });
+    }
+
+    void get_core_stats(std::vector<clip_npu_core_stats_t> &stats) override
+    {
+        auto now = std::chrono::steady_clock::now();
+        stats.clear();
+        for (auto &replica : m_replicas)
         {
-            unsigned char *inputPtr = (unsigned char *)m_encoder->get_input(0).pVirAddr;
-            memcpy(inputPtr, input.data, input.width * input.height * 3);
+            clip_npu_core_stats_t st;
+            st.devid = replica->devid;
+            st.healthy = replica->healthy;
+            st.core_mask = replica->core_mask;
+            st.inflight = replica->inflight;
+            st.runs = replica->runs;
+            st.busy_us = replica->busy_us;
+            long long alive_us = std::chrono::duration_cast<std::chrono::microseconds>(now - replica->loaded_at).count();
+            st.utilization = alive_us > 0 ? (float)st.busy_us / alive_us : 0.f;
+            stats.push_back(st);
         }
-
-        auto ret = m_encoder->inference();
-
-        image_features.resize(LEN_IMAGE_FEATURE);
-        // m_encoder->mem_sync_output(0);
-        memcpy(image_features.data(), m_encoder->get_output(0).pVirAddr, LEN_IMAGE_FEATURE * sizeof(float));
-
-        float norm = 0.0f;
-        for (float v : image_features)
-            norm += v * v;
-        norm = std::sqrt(norm);
-        for (float &v : image_features)
-            v /= norm;
-
-        return true;
     }
 };
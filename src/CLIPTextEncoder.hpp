@@ -60,11 +60,36 @@ protected:
     CLIPType clip_type = CLIPType::unknown;
     std::string bos_str;
     std::string eos_str;
+    // ids of bos_str / eos_str when each is a single special token (-1 for none),
+    // lets the encoder emit them directly instead of re-scanning them in every query
+    int bos_id = -1;
+    int eos_id = -1;
+    bool direct_special_ids = false;
+
+    int special_id(const std::string &str, bool &ok)
+    {
+        if (str.empty())
+        {
+            return -1;
+        }
+        std::vector<int> ids;
+        tokenizer->encode_append(str, ids);
+        if (ids.size() != 1 || !tokenizer->is_special(ids[0]))
+        {
+            ok = false;
+            return -1;
+        }
+        return ids[0];
+    }
 
     void setup_clip_params()
     {
         bos_str = bos_eos_map[clip_type].first;
         eos_str = bos_eos_map[clip_type].second;
+
+        direct_special_ids = true;
+        bos_id = special_id(bos_str, direct_special_ids);
+        eos_id = special_id(eos_str, direct_special_ids);
         
         if (clip_type == CLIPType::jina_clip_v2)
         {
@@ -81,6 +106,7 @@ protected:
         
         ALOGI("clip_type: %d, bos_str: '%s', eos_str: '%s', PAD_TOKEN: %d", 
               (int)clip_type, bos_str.c_str(), eos_str.c_str(), PAD_TOKEN);
+        ALOGI("bos id: %d, eos id: %d, direct special ids: %d", bos_id, eos_id, direct_special_ids);
     }
 
     bool detect_clip_type()
@@ -117,13 +143,31 @@ protected:
 
 public:
     virtual bool load_text_encoder(clip_init_t *clip_init) = 0;
+    // release the model and its IO buffers, the tokenizer stays loaded
+    virtual void unload_text_encoder() = 0;
+    virtual bool is_loaded() = 0;
     virtual bool encode(std::vector<std::string> &texts, std::vector<std::vector<float>> &text_features) = 0;
+    // token ids must already hold the special tokens the tokenizer would add (BOS/EOS), padding is added here;
+    // lengths in [1, get_text_token_len()] and ids in [0, get_vocab_size()) are checked by the caller
+    virtual bool encode_ids(std::vector<std::vector<int>> &ids, std::vector<std::vector<float>> &text_features) = 0;
     
     int get_text_feature_size()
     {
         return LEN_TEXT_FEATURE;
     }
 
+    // longest token sequence the loaded model takes
+    int get_text_token_len()
+    {
+        return LEN_TEXT_TOKEN;
+    }
+
+    // valid token ids are [0, get_vocab_size()), 0 until the tokenizer is loaded
+    int get_vocab_size()
+    {
+        return tokenizer ? tokenizer->vocab_size() : 0;
+    }
+
     CLIPType get_clip_type()
     {
         return clip_type;
@@ -2,66 +2,292 @@
 #include "CLIPTextEncoder.hpp"
 #include "runner/ax650/ax_model_runner_ax650.hpp"
 #include "runner/axcl/ax_model_runner_axcl.hpp"
+#include "runner/mock/ax_model_runner_mock.hpp"
+#include "runner/ax_model_registry.hpp"
 #include "mmap.hpp"
 
 #include <math.h>
+#include <future>
+#include <algorithm>
 
 class CLIPTextEncoderAX650 : public CLIPTextEncoder
 {
 private:
     std::shared_ptr<ax_runner_base> m_encoder;
 
-public:
-    bool load_text_encoder(clip_init_t *init_info) override
+    struct text_group_t
     {
-        MMap text_mmap(init_info->text_encoder_path);
+        int token_len;
+        int batch;
+        int grpid;
+    };
+    // sorted by token length, then batch size ascending
+    std::vector<text_group_t> m_groups;
+
+    // token buffers of the current and next window, reused across calls
+    std::vector<std::vector<int>> m_tokens;
+    std::vector<std::vector<int>> m_next_tokens;
 
-        if (init_info->dev_type == ax_devive_e::host_device)
+    // shortest compiled token length that holds n tokens
+    int select_token_len(int n)
+    {
+        for (auto &g : m_groups)
         {
+            if (g.token_len >= n)
+            {
+                return g.token_len;
+            }
+        }
+        return LEN_TEXT_TOKEN;
+    }
 
-            m_encoder = std::make_shared<ax_runner_ax650>();
-            auto ret = m_encoder->init(text_mmap.data(), text_mmap.size(), -1);
-            if (ret != 0)
+    // largest group of the given token length that fits the remaining texts, or the smallest one if none fits
+    const text_group_t &select_group(int token_len, int remain)
+    {
+        const text_group_t *sel = nullptr;
+        for (auto &g : m_groups)
+        {
+            if (g.token_len != token_len)
             {
-                printf("text encoder init failed\n");
+                continue;
+            }
+            if (sel == nullptr || g.batch <= remain)
+            {
+                sel = &g;
+            }
+        }
+        return *sel;
+    }
 
-                return false;
+    int run(int slot, int grpid)
+    {
+        return slot == 0 && grpid == 0 ? m_encoder->inference() : m_encoder->inference(grpid, slot);
+    }
+
+    bool tokenize(const std::string &src, std::vector<int> &text_token)
+    {
+        if (direct_special_ids)
+        {
+            // emit BOS/EOS ids around the text tokens, text_token keeps its capacity between calls
+            text_token.assign(tokenizer->get_prefix_tokens().begin(), tokenizer->get_prefix_tokens().end());
+            // SigLIP2: add_eos_token=True, add_bos_token=False
+            if (bos_id >= 0 && clip_type != CLIPType::siglip2)
+            {
+                text_token.push_back(bos_id);
+            }
+            tokenizer->encode_append(src, text_token);
+            if (eos_id >= 0)
+            {
+                text_token.push_back(eos_id);
             }
         }
-        else if (init_info->dev_type == ax_devive_e::axcl_device)
+        else
         {
-            m_encoder = std::make_shared<ax_runner_axcl>();
-            auto ret = m_encoder->init(text_mmap.data(), text_mmap.size(), init_info->devid);
-            if (ret != 0)
+            std::string text;
+            // SigLIP2: add_eos_token=True, add_bos_token=False
+            // Other CLIP: add both bos and eos
+            if (clip_type == CLIPType::siglip2)
             {
-                printf("text encoder init failed\n");
+                text = src + eos_str;
+            }
+            else
+            {
+                text = bos_str + src + eos_str;
+            }
+            text_token = tokenizer->encode(text);
+        }
+        if (text_token.size() > LEN_TEXT_TOKEN)
+        {
+            ALOGW("the text of \"%s\" token bigger than %d\n", src.c_str(), LEN_TEXT_TOKEN);
+            return false;
+        }
+        return true;
+    }
 
+    bool tokenize(std::vector<std::string> &texts, size_t offset, int count, std::vector<std::vector<int>> &tokens)
+    {
+        tokens.resize(count);
+        for (int b = 0; b < count; b++)
+        {
+            if (!tokenize(texts[offset + b], tokens[b]))
+            {
                 return false;
             }
         }
+        return true;
+    }
+
+    void postprocess(int slot, int grpid, int batch_idx, std::vector<float> &text_feat)
+    {
+        text_feat.resize(LEN_TEXT_FEATURE);
+        // m_encoder->mem_sync_output(0);
+        float *outputPtr = (float *)m_encoder->get_slot_output(slot, grpid, 0).pVirAddr + batch_idx * LEN_TEXT_FEATURE;
+        memcpy(text_feat.data(), outputPtr, LEN_TEXT_FEATURE * sizeof(float));
+
+        float norm = 0.0f;
+        for (float v : text_feat)
+            norm += v * v;
+        norm = std::sqrt(norm);
+        for (float &v : text_feat)
+            v /= norm;
+    }
+
+public:
+    bool load_text_encoder(clip_init_t *init_info) override
+    {
+        // the runner comes from the process-wide registry, handles loading the same model share one
+        int devid = init_info->dev_type == ax_devive_e::axcl_device ? init_info->devid : -1;
+        auto key = ax_model_registry::make_key(init_info->text_encoder_path, init_info->dev_type, devid,
+                                               "slots=1,affinity=" + std::to_string(init_info->text_npu_affinity));
+        m_encoder = ax_model_registry::instance().acquire(key, [&]() -> ax_runner_base *
+                                                         {
+            ax_runner_base *runner = nullptr;
+            if (init_info->dev_type == ax_devive_e::host_device)
+            {
+                runner = new ax_runner_ax650;
+            }
+            else if (init_info->dev_type == ax_devive_e::axcl_device)
+            {
+                runner = new ax_runner_axcl;
+            }
+            else if (init_info->dev_type == ax_devive_e::mock_device)
+            {
+                runner = new ax_runner_mock;
+            }
+            else
+            {
+                return nullptr;
+            }
+            std::string model_path = init_info->text_encoder_path;
+            if (init_info->dev_type == ax_devive_e::mock_device)
+            {
+                model_path = ax_runner_mock::spec_path(model_path);
+            }
+            MMap text_mmap(model_path.c_str());
+            runner->set_io_pool_size((size_t)std::max(init_info->io_pool_mb, 0) << 20);
+            auto ret = runner->init(text_mmap.data(), text_mmap.size(), devid);
+            if (ret != 0)
+            {
+                printf("text encoder init failed\n");
+                // init may have created some contexts and io buffers before failing
+                runner->deinit();
+                delete runner;
+                return nullptr;
+            }
+            if (init_info->text_npu_affinity != 0)
+            {
+                // pin to dedicated NPU cores so the other encoder's lane does not queue behind this one
+                ret = runner->set_affinity(init_info->text_npu_affinity);
+                if (ret != 0)
+                {
+                    ALOGW("text encoder set affinity 0x%x failed, ret=%d", init_info->text_npu_affinity, ret);
+                }
+            }
+            return runner; });
+        if (!m_encoder)
+        {
+            return false;
+        }
         LEN_TEXT_TOKEN = m_encoder->get_input(0).vShape[m_encoder->get_input(0).vShape.size() - 1];
         LEN_TEXT_FEATURE = m_encoder->get_output(0).vShape[m_encoder->get_output(0).vShape.size() - 1];
+
+        // shape groups may differ in leading batch dim (several sequences per inference) and in
+        // token length (short queries run on a shorter context), the feature length must match
+        m_groups.clear();
+        for (int grpid = 0; grpid < m_encoder->get_num_input_groups(); grpid++)
+        {
+            auto &in_shape = m_encoder->get_input(grpid, 0).vShape;
+            auto &out_shape = m_encoder->get_output(grpid, 0).vShape;
+            if (in_shape.size() < 2 || out_shape.size() < 2 || in_shape[0] != out_shape[0])
+            {
+                continue;
+            }
+            if ((int)out_shape[out_shape.size() - 1] != LEN_TEXT_FEATURE)
+            {
+                continue;
+            }
+            m_groups.push_back({(int)in_shape[in_shape.size() - 1], (int)in_shape[0], grpid});
+        }
+        if (m_groups.empty())
+        {
+            m_groups.push_back({LEN_TEXT_TOKEN, 1, 0});
+        }
+        std::stable_sort(m_groups.begin(), m_groups.end(), [](const text_group_t &a, const text_group_t &b)
+                         { return a.token_len != b.token_len ? a.token_len < b.token_len : a.batch < b.batch; });
+        LEN_TEXT_TOKEN = m_groups.back().token_len;
+        for (auto &g : m_groups)
+        {
+            ALOGI("text encoder group %d token len %d batch %d", g.grpid, g.token_len, g.batch);
+        }
         ALOGI("text token len %d, text feature len %d", LEN_TEXT_TOKEN, LEN_TEXT_FEATURE);
         return true;
     }
 
+    // drops this handle's reference, the registry deinits the runner once no handle uses it
+    void unload_text_encoder() override
+    {
+        m_encoder.reset();
+    }
+
+    bool is_loaded() override
+    {
+        return m_encoder != nullptr;
+    }
+
+    // copy the tokens and pad only the tail
     template <typename T>
     void fill_ids(T *data, int len, std::vector<int> &text_token, int pad_token = 0)
     {
-        memset(data, 0, len * sizeof(T));
-        for (int i = 0; i < len; i++)
+        int n = std::min(len, (int)text_token.size());
+        std::copy(text_token.begin(), text_token.begin() + n, data);
+        std::fill(data + n, data + len, (T)pad_token);
+    }
+
+private:
+    // run one window of tokenized texts, bucketed by the shortest token length that holds them
+    bool run_window(size_t offset, std::vector<std::vector<int>> &tokens, std::vector<std::vector<float>> &text_features)
+    {
+        std::map<int, std::vector<int>> buckets;
+        for (size_t i = 0; i < tokens.size(); i++)
         {
-            if (i < (int)text_token.size())
-            {
-                data[i] = text_token[i];
-            }
-            else
+            buckets[select_token_len(tokens[i].size())].push_back(i);
+        }
+
+        for (auto &[token_len, indices] : buckets)
+        {
+            for (size_t pos = 0; pos < indices.size();)
             {
-                data[i] = pad_token;
+                int remain = indices.size() - pos;
+                auto &g = select_group(token_len, remain);
+                int count = std::min(g.batch, remain);
+                // the runner may be shared with other handles, so the io buffers come from its slot pool
+                int slot = m_encoder->acquire_slot();
+                int32_t *inputPtr = (int32_t *)m_encoder->get_slot_input(slot, g.grpid, 0).pVirAddr;
+                for (int b = 0; b < count; b++)
+                {
+                    fill_ids(inputPtr + b * token_len, token_len, tokens[indices[pos + b]], PAD_TOKEN);
+                }
+                m_encoder->set_valid_batch(slot, g.grpid, count);
+
+                auto ret = run(slot, g.grpid);
+                if (ret != 0)
+                {
+                    m_encoder->release_slot(slot);
+                    ALOGE("text encoder inference failed, grpid=%d ret=%d", g.grpid, ret);
+                    return false;
+                }
+                for (int b = 0; b < count; b++)
+                {
+                    postprocess(slot, g.grpid, b, text_features[offset + indices[pos + b]]);
+                }
+                m_encoder->release_slot(slot);
+                pos += count;
             }
         }
+        return true;
     }
 
+public:
     bool encode(std::vector<std::string> &texts, std::vector<std::vector<float>> &text_features) override
     {
         if (m_encoder == nullptr)
@@ -69,41 +295,58 @@ public:
             return false;
         }
         text_features.resize(texts.size());
-        for (size_t i = 0; i < texts.size(); i++)
+        if (texts.empty())
         {
-            std::string text;
-            // SigLIP2: add_eos_token=True, add_bos_token=False
-            // Other CLIP: add both bos and eos
-            if (clip_type == CLIPType::siglip2)
-            {
-                text = texts[i] + eos_str;
-            }
-            else
+            return true;
+        }
+
+        // texts are handled in windows of the largest batch, the next window is tokenized
+        // while the NPU runs the current one
+        int window = 1;
+        for (auto &g : m_groups)
+        {
+            window = std::max(window, g.batch);
+        }
+        auto window_count = [&](size_t offset)
+        {
+            return (int)std::min<size_t>(window, texts.size() - offset);
+        };
+
+        auto &tokens = m_tokens;
+        if (!tokenize(texts, 0, window_count(0), tokens))
+        {
+            return false;
+        }
+        for (size_t offset = 0; offset < texts.size(); offset += window)
+        {
+            size_t next_offset = offset + window;
+            auto &next_tokens = m_next_tokens;
+            std::future<bool> next;
+            if (next_offset < texts.size())
             {
-                text = bos_str + texts[i] + eos_str;
+                next = std::async(std::launch::async, [&]()
+                                  { return tokenize(texts, next_offset, window_count(next_offset), next_tokens); });
             }
-            std::vector<int> text_token = tokenizer->encode(text);
-            if (text_token.size() > LEN_TEXT_TOKEN)
+
+            bool ok = run_window(offset, tokens, text_features);
+            bool next_ok = next.valid() ? next.get() : true;
+            if (!ok || !next_ok)
             {
-                ALOGW("the text of \"%s\" token bigger than %d\n", texts[i].c_str(), LEN_TEXT_TOKEN);
                 return false;
             }
-
-            fill_ids((int32_t *)m_encoder->get_input(0).pVirAddr, LEN_TEXT_TOKEN, text_token, PAD_TOKEN);
-            m_encoder->inference();
-            text_features[i].resize(LEN_TEXT_FEATURE);
-            // m_encoder->mem_sync_output(0);
-            memcpy(text_features[i].data(), m_encoder->get_output(0).pVirAddr, LEN_TEXT_FEATURE * sizeof(float));
-
-            auto &text_feat = text_features[i];
-            float norm = 0.0f;
-            for (float v : text_feat)
-                norm += v * v;
-            norm = std::sqrt(norm);
-            for (float &v : text_feat)
-                v /= norm;
+            tokens.swap(next_tokens);
         }
 
         return true;
     }
+
+    bool encode_ids(std::vector<std::vector<int>> &ids, std::vector<std::vector<float>> &text_features) override
+    {
+        if (m_encoder == nullptr)
+        {
+            return false;
+        }
+        text_features.resize(ids.size());
+        return run_window(0, ids, text_features);
+    }
 };
@@ -7,6 +7,7 @@
 
 #include "runner/ax650/ax_api_loader.h"
 #include "runner/ax650/ax_model_runner_ax650.hpp"
+#include "runner/ax_io_pool.hpp"
 
 #include <cstring>
 #include <mutex>
@@ -84,6 +85,17 @@ int ax_dev_enum_devices(ax_devices_t *devices)
 
 int ax_dev_sys_init(ax_devive_e dev_type, char devid)
 {
+    return ax_dev_sys_init_vnpu(dev_type, devid, ax_dev_vnpu_disable);
+}
+
+int ax_dev_sys_init_vnpu(ax_devive_e dev_type, char devid, ax_dev_vnpu_mode_e vnpu_mode)
+{
+    if (vnpu_mode < ax_dev_vnpu_disable || vnpu_mode > ax_dev_vnpu_little_big)
+    {
+        printf("invalid vnpu mode %d\n", (int)vnpu_mode);
+        return ax_dev_errcode_sysinit_failed;
+    }
+
     if (dev_type == ax_devive_e::host_device)
     {
         if (get_ax_sys_loader().is_init() && get_ax_engine_loader().is_init())
@@ -99,11 +111,11 @@ int ax_dev_sys_init(ax_devive_e dev_type, char devid)
 
             AX_ENGINE_NPU_ATTR_T npu_attr;
             memset(&npu_attr, 0, sizeof(AX_ENGINE_NPU_ATTR_T));
-            npu_attr.eHardMode = AX_ENGINE_VIRTUAL_NPU_DISABLE;
+            npu_attr.eHardMode = (AX_ENGINE_NPU_MODE_T)vnpu_mode;
             ret = ax_engine_loader.AX_ENGINE_Init(&npu_attr);
             if (ret != 0)
             {
-                printf("AX_ENGINE_Init failed\n");
+                printf("AX_ENGINE_Init failed, vnpu mode %d\n", (int)vnpu_mode);
                 return ax_dev_errcode_sysinit_failed;
             }
             return ax_dev_errcode_success;
@@ -121,7 +133,7 @@ int ax_dev_sys_init(ax_devive_e dev_type, char devid)
             return init_ret;
         }
 
-        auto ret = axcl_Dev_Init(devid);
+        auto ret = axcl_Dev_Init_VNpu(devid, vnpu_mode);
         if (ret != 0)
         {
             printf("axcl_Dev_Init failed\n");
@@ -130,6 +142,12 @@ int ax_dev_sys_init(ax_devive_e dev_type, char devid)
         return ax_dev_errcode_success;
     }
 
+    if (dev_type == ax_devive_e::mock_device)
+    {
+        // nothing to bring up, the mock runner only uses the CPU
+        return ax_dev_errcode_success;
+    }
+
     return ax_dev_errcode_sysinit_failed;
 }
 
@@ -141,6 +159,9 @@ int ax_dev_sys_deinit(ax_devive_e dev_type, char devid)
         {
             AxSysApiLoader &ax_sys_loader = get_ax_sys_loader();
             AxEngineApiLoader &ax_engine_loader = get_ax_engine_loader();
+            // io pool blocks are CMM allocations, hand them back while the system is still up
+            ax_io_pool::trim("ax650");
+            ax_io_pool::trim("ax650_cached");
             auto ret = ax_engine_loader.AX_ENGINE_Deinit();
             if (ret != 0)
             {
@@ -168,6 +189,7 @@ int ax_dev_sys_deinit(ax_devive_e dev_type, char devid)
             return ax_dev_errcode_axcl_sysdeinit_failed;
         }
 
+        ax_io_pool::trim("axcl:" + std::to_string(devid));
         auto ret = axcl_Dev_Exit(devid);
         if (ret != 0)
         {
@@ -177,5 +199,10 @@ int ax_dev_sys_deinit(ax_devive_e dev_type, char devid)
         return ax_dev_errcode_success;
     }
 
+    if (dev_type == ax_devive_e::mock_device)
+    {
+        return ax_dev_errcode_success;
+    }
+
     return ax_dev_errcode_sysdeinit_failed;
 }
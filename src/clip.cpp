@@ -9,14 +9,30 @@
 #include "runner/ax650/ax_model_runner_ax650.hpp"
 
 #include "CLIP.hpp"
+#include "CLIPClassifier.hpp"
+#include "bounded_queue.hpp"
+#include "image_decode.hpp"
+#include "phash.hpp"
+#include "lru_cache.hpp"
 
 #include "leveldb/db.h"
 #include "leveldb/options.h"
+#include "leveldb/write_batch.h"
 
 #include <queue>
+#include <deque>
 #include <cstring>
+#include <cctype>
 #include <fstream>
 #include <memory>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_set>
+#include <thread>
+#include <filesystem>
+#include <functional>
+#include <chrono>
 
 AxclApiLoader &getLoader();
 AxSysApiLoader &get_ax_sys_loader();
@@ -25,15 +41,382 @@ AxEngineApiLoader &get_ax_engine_loader();
 struct clip_internal_handle_t
 {
     CLIP m_clip;
+
+    // guards the gallery (keys, features, dedup state); encoders run outside of it so a
+    // text query does not wait for an image encode, only for the brief insert that follows
+    std::shared_mutex m_gallery_mutex;
     std::vector<std::string> m_keys;
     std::vector<std::vector<float>> m_image_features;
 
-    leveldb::DB *m_db;
+    clip_dedup_config_t m_dedup_config = {clip_dedup_off, 5, 64};
+    clip_dedup_stats_t m_dedup_stats = {0, 0, 0};
+    std::deque<std::pair<uint64_t, std::string>> m_dedup_history;
+
+    // resolved from the loaded tokenizer, so an auto-detected model normalizes its cache keys too
+    CLIPType m_clip_type = CLIPType::unknown;
+    LRUCache<std::string, std::vector<float>> m_text_cache;
+
+    // on-disk text features next to the gallery db, opened on first use
+    bool m_text_store_enabled = false;
+    std::string m_text_store_path;
+    std::string m_text_model_id;
+    std::once_flag m_text_store_once;
+    leveldb::DB *m_text_store = nullptr;
+
+    leveldb::DB *m_db = nullptr;
     leveldb::Options m_options;
     leveldb::WriteOptions m_write_options;
     leveldb::ReadOptions m_read_options;
+
+    clip_startup_stats_t m_startup_stats = {0, 0, 0, 0, 0, 0};
+};
+
+// one independent part of clip_create, timed on whichever thread runs it
+struct startup_stage_t
+{
+    const char *name;
+    int errcode;
+    std::function<bool()> load;
+    float *ms;
+    bool ok = false;
+
+    // a throwing stage only fails itself, it must not escape a startup thread
+    void run()
+    {
+        auto start = std::chrono::steady_clock::now();
+        try
+        {
+            ok = load();
+        }
+        catch (const std::exception &e)
+        {
+            printf("load %s threw: %s\n", name, e.what());
+            ok = false;
+        }
+        catch (...)
+        {
+            printf("load %s threw\n", name);
+            ok = false;
+        }
+        *ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+// runs the stages in order, stopping at the first failure, or all at once (the last on the calling thread);
+// returns the error code of the first failed stage, every failure is printed
+static int run_startup_stages(std::vector<startup_stage_t> &stages, bool parallel)
+{
+    if (parallel)
+    {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i + 1 < stages.size(); i++)
+        {
+            threads.emplace_back(&startup_stage_t::run, &stages[i]);
+        }
+        stages.back().run();
+        for (auto &t : threads)
+        {
+            t.join();
+        }
+    }
+
+    int errcode = clip_errcode_success;
+    for (auto &stage : stages)
+    {
+        if (!parallel)
+        {
+            stage.run();
+        }
+        if (!stage.ok)
+        {
+            printf("load %s failed\n", stage.name);
+            if (errcode == clip_errcode_success)
+            {
+                errcode = stage.errcode;
+            }
+            if (!parallel)
+            {
+                break;
+            }
+        }
+    }
+    return errcode;
+}
+
+struct clip_internal_classifier_t
+{
+    clip_internal_handle_t *m_handle;
+    CLIPClassifier m_classifier;
 };
 
+static int find_key(clip_internal_handle_t *handle, const char *key)
+{
+    for (int i = 0; i < handle->m_keys.size(); i++)
+    {
+        if (strcmp(handle->m_keys[i].c_str(), key) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// the helpers below expect the caller to hold m_gallery_mutex
+
+// insert or replace features in memory, then persist them with one write
+static bool put_features(clip_internal_handle_t *handle, const std::vector<std::string> &keys, const std::vector<std::vector<float>> &features)
+{
+    leveldb::WriteBatch write_batch;
+    for (size_t j = 0; j < keys.size(); j++)
+    {
+        auto &key = keys[j];
+        auto &feat = features[j];
+        int index = find_key(handle, key.c_str());
+        if (index >= 0)
+        {
+            handle->m_image_features[index] = feat;
+        }
+        else
+        {
+            handle->m_keys.push_back(key);
+            handle->m_image_features.push_back(feat);
+        }
+        write_batch.Put(leveldb::Slice(key), leveldb::Slice((char *)feat.data(), feat.size() * sizeof(float)));
+    }
+    leveldb::Status status = handle->m_db->Write(handle->m_write_options, &write_batch);
+    if (!status.ok())
+    {
+        printf("put db failed, status: %s\n", status.ToString().c_str());
+        return false;
+    }
+    return true;
+}
+
+// near-duplicate gate: true when the image hash is within the Hamming threshold of a recently added image
+static bool dedup_lookup(clip_internal_handle_t *handle, uint64_t hash, std::string &matched_key)
+{
+    for (auto it = handle->m_dedup_history.rbegin(); it != handle->m_dedup_history.rend(); ++it)
+    {
+        if (hamming_distance64(it->first, hash) <= handle->m_dedup_config.hamming_threshold)
+        {
+            matched_key = it->second;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void dedup_remember(clip_internal_handle_t *handle, uint64_t hash, const std::string &key)
+{
+    handle->m_dedup_history.push_back({hash, key});
+    while ((int)handle->m_dedup_history.size() > handle->m_dedup_config.history)
+    {
+        handle->m_dedup_history.pop_front();
+    }
+}
+
+// returns clip_errcode_success when the image still has to be encoded,
+// otherwise the image was skipped or stored with a reused feature and the code is final
+static int dedup_gate(clip_internal_handle_t *handle, const char *key, clip_image_t *image, uint64_t &hash, bool &handled)
+{
+    handled = false;
+    if (handle->m_dedup_config.mode == clip_dedup_off)
+    {
+        return clip_errcode_success;
+    }
+
+    hash = dhash64(image->data, image->width, image->height, image->channels, image->stride);
+    handle->m_dedup_stats.checked++;
+
+    std::string matched_key;
+    if (!dedup_lookup(handle, hash, matched_key))
+    {
+        return clip_errcode_success;
+    }
+
+    if (handle->m_dedup_config.mode == clip_dedup_skip)
+    {
+        handle->m_dedup_stats.skipped++;
+        handled = true;
+        return clip_errcode_add_failed_near_duplicate;
+    }
+
+    int index = find_key(handle, matched_key.c_str());
+    if (index < 0)
+    {
+        // the matched image has been removed in the meantime, encode as usual
+        return clip_errcode_success;
+    }
+    handle->m_dedup_stats.reused++;
+    handled = true;
+    std::vector<float> feat = handle->m_image_features[index];
+    if (!put_features(handle, {key}, {feat}))
+    {
+        return clip_errcode_add_failed_push_db;
+    }
+    dedup_remember(handle, hash, key);
+    return clip_errcode_success;
+}
+
+// cache key for a text query: trimmed, inner whitespace collapsed, lower-cased for the uncased tokenizers
+static std::string normalize_text_key(const char *text, CLIPType clip_type)
+{
+    bool lower = clip_type == CLIPType::clip || clip_type == CLIPType::cn_clip;
+    std::string key;
+    bool pending_space = false;
+    for (const char *p = text; *p; p++)
+    {
+        unsigned char c = *p;
+        if (std::isspace(c))
+        {
+            pending_space = !key.empty();
+            continue;
+        }
+        if (pending_space)
+        {
+            key.push_back(' ');
+            pending_space = false;
+        }
+        key.push_back(lower && c < 0x80 ? std::tolower(c) : c);
+    }
+    return key;
+}
+
+// identifies the text model + tokenizer by path, size and modification time, so a replaced model never serves stale features from the store
+static std::string text_model_id(clip_init_t *init_info)
+{
+    uint64_t hash = 1469598103934665603ull; // FNV-1a
+    auto mix = [&hash](const void *data, size_t len)
+    {
+        const unsigned char *p = (const unsigned char *)data;
+        for (size_t i = 0; i < len; i++)
+        {
+            hash = (hash ^ p[i]) * 1099511628211ull;
+        }
+    };
+    for (const char *path : {init_info->text_encoder_path, init_info->tokenizer_path})
+    {
+        mix(path, strlen(path));
+        std::error_code ec;
+        uint64_t size = std::filesystem::file_size(path, ec);
+        if (!ec)
+        {
+            mix(&size, sizeof(size));
+        }
+        int64_t mtime = std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+        if (!ec)
+        {
+            mix(&mtime, sizeof(mtime));
+        }
+    }
+    mix(&init_info->model_type, sizeof(init_info->model_type));
+    char buf[17];
+    snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)hash);
+    return buf;
+}
+
+static leveldb::DB *get_text_store(clip_internal_handle_t *handle)
+{
+    if (!handle->m_text_store_enabled)
+    {
+        return nullptr;
+    }
+    std::call_once(handle->m_text_store_once, [handle]()
+                   {
+        leveldb::Options options;
+        options.create_if_missing = true;
+        leveldb::Status status = leveldb::DB::Open(options, handle->m_text_store_path, &handle->m_text_store);
+        if (!status.ok())
+        {
+            printf("open text feature store failed, status: %s\n", status.ToString().c_str());
+            handle->m_text_store = nullptr;
+        } });
+    return handle->m_text_store;
+}
+
+// memory cache -> disk store -> text encoder; new features are written back to both layers
+static int get_text_features(clip_internal_handle_t *handle, const std::vector<std::string> &texts, std::vector<std::vector<float>> &features)
+{
+    features.resize(texts.size());
+    std::vector<std::string> cache_keys(texts.size());
+    std::vector<int> missing;
+    leveldb::DB *store = get_text_store(handle);
+    int feat_size = -1; // asked for on the first disk hit only, it loads a lazily loaded encoder
+    for (size_t i = 0; i < texts.size(); i++)
+    {
+        cache_keys[i] = normalize_text_key(texts[i].c_str(), handle->m_clip_type);
+        if (handle->m_text_cache.get(cache_keys[i], features[i]))
+        {
+            continue;
+        }
+        std::string value;
+        if (store && store->Get(handle->m_read_options, handle->m_text_model_id + ":" + cache_keys[i], &value).ok())
+        {
+            if (feat_size < 0)
+            {
+                feat_size = handle->m_clip.get_text_feature_size();
+            }
+            // a record of any other length is corrupt or from another model, encode the text again
+            if (feat_size <= 0 || value.size() != feat_size * sizeof(float))
+            {
+                missing.push_back(i);
+                continue;
+            }
+            features[i].resize(value.size() / sizeof(float));
+            memcpy(features[i].data(), value.data(), value.size());
+            handle->m_text_cache.put(cache_keys[i], features[i]);
+            continue;
+        }
+        missing.push_back(i);
+    }
+    if (missing.empty())
+    {
+        return clip_errcode_success;
+    }
+
+    std::vector<std::string> missing_texts;
+    for (auto i : missing)
+    {
+        missing_texts.push_back(texts[i]);
+    }
+    std::vector<std::vector<float>> text_features;
+    auto ret = handle->m_clip.encode(missing_texts, text_features);
+    if (!ret)
+    {
+        printf("encode text failed\n");
+        return clip_errcode_match_failed_encode_text;
+    }
+    if (text_features.size() != missing.size())
+    {
+        printf("encode text failed, text_features size: %ld\n", text_features.size());
+        return clip_errcode_match_failed_encode_text;
+    }
+
+    leveldb::WriteBatch write_batch;
+    for (size_t j = 0; j < missing.size(); j++)
+    {
+        int i = missing[j];
+        if (text_features[j].size() > CLIP_TEXT_FEAT_MAX_LEN)
+        {
+            printf("encode text failed, text_features size: %ld > %d\n", text_features[j].size(), CLIP_TEXT_FEAT_MAX_LEN);
+            return clip_errcode_match_failed_encode_text;
+        }
+        features[i] = std::move(text_features[j]);
+        handle->m_text_cache.put(cache_keys[i], features[i]);
+        write_batch.Put(handle->m_text_model_id + ":" + cache_keys[i], leveldb::Slice((char *)features[i].data(), features[i].size() * sizeof(float)));
+    }
+    if (store)
+    {
+        leveldb::Status status = store->Write(handle->m_write_options, &write_batch);
+        if (!status.ok())
+        {
+            // the features are still valid, they just will not survive a restart
+            printf("put text feature store failed, status: %s\n", status.ToString().c_str());
+        }
+    }
+    return clip_errcode_success;
+}
+
 int clip_create(clip_init_t *init_info, clip_handle_t *_handle)
 {
     if (init_info->dev_type == ax_devive_e::host_device)
@@ -57,108 +440,611 @@ int clip_create(clip_init_t *init_info, clip_handle_t *_handle)
             printf("axcl device %d not init\n", init_info->devid);
             return clip_errcode_create_failed_sys;
         }
+        for (int i = 0; i < std::min(init_info->pool_num_devices, CLIP_MAX_POOL_DEVICES); i++)
+        {
+            if (!axcl_Dev_IsInit(init_info->pool_devids[i]))
+            {
+                printf("axcl pool device %d not init\n", init_info->pool_devids[i]);
+                return clip_errcode_create_failed_sys;
+            }
+        }
     }
-    else
+    else if (init_info->dev_type != ax_devive_e::mock_device)
     {
         return clip_errcode_failed;
     }
 
+    auto create_start = std::chrono::steady_clock::now();
     clip_internal_handle_t *handle = new clip_internal_handle_t;
-    auto ret = handle->m_clip.load_image_encoder(init_info);
-    if (!ret)
+    handle->m_clip.set_load_policy(init_info);
+
+    handle->m_text_cache.set_capacity(init_info->text_cache_size == 0 ? 256 : std::max(init_info->text_cache_size, 0));
+
+    if (init_info->text_cache_persist)
+    {
+        std::string db_path = init_info->db_path;
+        while (db_path.size() > 1 && db_path.back() == '/')
+        {
+            db_path.pop_back();
+        }
+        handle->m_text_store_enabled = true;
+        handle->m_text_store_path = db_path + ".text_cache";
+        handle->m_text_model_id = text_model_id(init_info);
+    }
+
+    // the stages touch disjoint state: flash reads and NPU handle creation for the encoders,
+    // tokenizer parsing on the CPU and the db scan into the gallery
+    auto &times = handle->m_startup_stats;
+    std::vector<startup_stage_t> stages;
+    stages.push_back({"image encoder", clip_errcode_create_failed_ienc, [&]()
+                      { return handle->m_clip.load_image_encoder(init_info); }, &times.image_encoder_ms});
+    stages.push_back({"text encoder", clip_errcode_create_failed_tenc, [&]()
+                      { return handle->m_clip.load_text_encoder(init_info); }, &times.text_encoder_ms});
+    stages.push_back({"tokenizer", clip_errcode_create_failed_vocab, [&]()
+                      { return handle->m_clip.load_tokenizer(init_info->tokenizer_path, init_info->model_type); }, &times.tokenizer_ms});
+    stages.push_back({"db", clip_errcode_create_failed_db, [&]()
+                      {
+                          handle->m_options.create_if_missing = true;
+                          leveldb::Status status = leveldb::DB::Open(handle->m_options, init_info->db_path, &handle->m_db);
+                          if (!status.ok())
+                          {
+                              printf("open db failed, status: %s\n", status.ToString().c_str());
+                              return false;
+                          }
+
+                          auto it = handle->m_db->NewIterator(handle->m_read_options);
+                          for (it->SeekToFirst(); it->Valid(); it->Next())
+                          {
+                              handle->m_keys.push_back(it->key().ToString());
+                              std::vector<float> image_features;
+                              image_features.resize(it->value().size() / sizeof(float));
+                              memcpy(image_features.data(), it->value().data(), it->value().size());
+                              handle->m_image_features.push_back(image_features);
+                              // printf("key: %s, value size: %ld\n", it->key().ToString().c_str(), it->value().size());
+                          }
+                          delete it;
+                          return true;
+                      },
+                      &times.db_ms});
+
+    times.parallel = init_info->parallel_startup != 0;
+    int ret = run_startup_stages(stages, times.parallel);
+    if (ret != clip_errcode_success)
     {
-        printf("load image encoder failed\n");
+        delete handle->m_db;
         delete handle;
-        return clip_errcode_create_failed_ienc;
+        return ret;
     }
-    ret = handle->m_clip.load_text_encoder(init_info);
+    handle->m_clip_type = handle->m_clip.get_clip_type();
+    handle->m_clip.start_idle_eviction();
+
+    times.total_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - create_start).count();
+    ALOGI("clip_create %s: image encoder %.1f ms, text encoder %.1f ms, tokenizer %.1f ms, db %.1f ms, total %.1f ms",
+          times.parallel ? "parallel" : "sequential", times.image_encoder_ms, times.text_encoder_ms,
+          times.tokenizer_ms, times.db_ms, times.total_ms);
+
+    *_handle = handle;
+    return clip_errcode_success;
+}
+
+int clip_destroy(clip_handle_t handle)
+{
+    clip_internal_handle_t *internal_handle = (clip_internal_handle_t *)handle;
+    if (internal_handle)
+    {
+        delete internal_handle->m_text_store;
+        delete internal_handle->m_db;
+        delete internal_handle;
+    }
+    return clip_errcode_success;
+}
+
+int clip_add(clip_handle_t handle, char key[CLIP_KEY_MAX_LEN], clip_image_t *image, char overwrite)
+{
+    clip_internal_handle_t *internal_handle = (clip_internal_handle_t *)handle;
+    if (internal_handle == nullptr)
+    {
+        printf("handle is null\n");
+        return clip_errcode_invalid_ptr;
+    }
+
+    uint64_t hash = 0;
+    {
+        std::unique_lock<std::shared_mutex> lock(internal_handle->m_gallery_mutex);
+        if (!overwrite && find_key(internal_handle, key) >= 0)
+        {
+            printf("key already exists\n");
+            return clip_errcode_add_failed_key_exist;
+        }
+
+        bool handled = false;
+        int gate_ret = dedup_gate(internal_handle, key, image, hash, handled);
+        if (handled)
+        {
+            return gate_ret;
+        }
+    }
+
+    std::vector<float> image_features;
+    auto ret = internal_handle->m_clip.encode(image, image_features);
     if (!ret)
     {
-        printf("load text encoder failed\n");
-        delete handle;
-        return clip_errcode_create_failed_tenc;
+        printf("encode image failed\n");
+        return clip_errcode_add_failed_encode_image;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(internal_handle->m_gallery_mutex);
+    // another caller may have added the key while the lock was released for the encode
+    if (!overwrite && find_key(internal_handle, key) >= 0)
+    {
+        printf("key already exists\n");
+        return clip_errcode_add_failed_key_exist;
+    }
+    if (internal_handle->m_dedup_config.mode != clip_dedup_off)
+    {
+        dedup_remember(internal_handle, hash, key);
+    }
+    if (!put_features(internal_handle, {key}, {image_features}))
+    {
+        return clip_errcode_add_failed_push_db;
+    }
+    return clip_errcode_success;
+}
+
+int clip_add_batch(clip_handle_t handle, char keys[][CLIP_KEY_MAX_LEN], clip_image_t *images, int num, char overwrite, int *status)
+{
+    clip_internal_handle_t *internal_handle = (clip_internal_handle_t *)handle;
+    if (internal_handle == nullptr || keys == nullptr || images == nullptr)
+    {
+        printf("handle is null\n");
+        return clip_errcode_invalid_ptr;
+    }
+
+    int first_err = clip_errcode_success;
+    auto set_status = [&](int i, int code)
+    {
+        if (status)
+        {
+            status[i] = code;
+        }
+        if (code != clip_errcode_success && first_err == clip_errcode_success)
+        {
+            first_err = code;
+        }
+    };
+
+    std::vector<int> indices;
+    std::vector<uint64_t> hashes;
+    std::vector<SimpleCV::Mat> batch;
+    std::unordered_set<std::string> batch_seen;
+    std::unique_lock<std::shared_mutex> lock(internal_handle->m_gallery_mutex);
+    for (int i = 0; i < num; i++)
+    {
+        set_status(i, clip_errcode_success);
+        // a bad image only fails itself, the rest of the batch is still encoded
+        auto &image = images[i];
+        if (image.data == nullptr)
+        {
+            printf("image %s data is null\n", keys[i]);
+            set_status(i, clip_errcode_invalid_ptr);
+            continue;
+        }
+        if (image.width <= 0 || image.height <= 0 || (image.channels != 1 && image.channels != 3 && image.channels != 4) ||
+            image.stride < image.width * image.channels)
+        {
+            printf("image %s: unsupported %dx%d, %d channels, stride %d\n", keys[i], image.width, image.height, image.channels, image.stride);
+            set_status(i, clip_errcode_invalid_param);
+            continue;
+        }
+        int index = find_key(internal_handle, keys[i]);
+        if ((index >= 0 || batch_seen.count(keys[i])) && !overwrite)
+        {
+            printf("key %s already exists\n", keys[i]);
+            set_status(i, clip_errcode_add_failed_key_exist);
+            continue;
+        }
+        bool handled = false;
+        uint64_t hash = 0;
+        int gate_ret = dedup_gate(internal_handle, keys[i], &images[i], hash, handled);
+        if (handled)
+        {
+            set_status(i, gate_ret);
+            continue;
+        }
+        batch_seen.insert(keys[i]);
+        indices.push_back(i);
+        hashes.push_back(hash);
+        batch.emplace_back(images[i].height, images[i].width, images[i].channels, images[i].data, images[i].stride);
+    }
+
+    lock.unlock();
+
+    if (batch.empty())
+    {
+        return first_err;
     }
-    ret = handle->m_clip.load_tokenizer(init_info->tokenizer_path, init_info->model_type);
+
+    std::vector<std::vector<float>> image_features;
+    auto ret = internal_handle->m_clip.encode(batch, image_features);
     if (!ret)
     {
-        printf("load tokenizer failed\n");
-        delete handle;
-        return clip_errcode_create_failed_vocab;
+        printf("encode image failed\n");
+        for (auto i : indices)
+        {
+            set_status(i, clip_errcode_add_failed_encode_image);
+        }
+        return first_err;
     }
 
-    handle->m_options.create_if_missing = true;
-    leveldb::Status status = leveldb::DB::Open(handle->m_options, init_info->db_path, &handle->m_db);
-    if (!status.ok())
+    lock.lock();
+    // another caller may have added some of the keys while the lock was released for the encode
+    std::vector<int> put_indices;
+    std::vector<uint64_t> put_hashes;
+    std::vector<std::string> batch_keys;
+    std::vector<std::vector<float>> batch_features;
+    for (size_t j = 0; j < indices.size(); j++)
     {
-        printf("open db failed, status: %s\n", status.ToString().c_str());
-        delete handle;
-        return clip_errcode_create_failed_db;
+        int i = indices[j];
+        if (!overwrite && find_key(internal_handle, keys[i]) >= 0)
+        {
+            printf("key %s already exists\n", keys[i]);
+            set_status(i, clip_errcode_add_failed_key_exist);
+            continue;
+        }
+        put_indices.push_back(i);
+        put_hashes.push_back(hashes[j]);
+        batch_keys.push_back(keys[i]);
+        batch_features.push_back(std::move(image_features[j]));
     }
+    if (batch_keys.empty())
+    {
+        return first_err;
+    }
+    if (!put_features(internal_handle, batch_keys, batch_features))
+    {
+        for (auto i : put_indices)
+        {
+            set_status(i, clip_errcode_add_failed_push_db);
+        }
+    }
+    else if (internal_handle->m_dedup_config.mode != clip_dedup_off)
+    {
+        for (size_t j = 0; j < batch_keys.size(); j++)
+        {
+            dedup_remember(internal_handle, put_hashes[j], batch_keys[j]);
+        }
+    }
+    return first_err;
+}
+
+int clip_add_rois(clip_handle_t handle, clip_image_t *image, clip_rect_t *rois, int num, const char *key_prefix, char overwrite)
+{
+    clip_internal_handle_t *internal_handle = (clip_internal_handle_t *)handle;
+    if (internal_handle == nullptr || image == nullptr || rois == nullptr || key_prefix == nullptr)
+    {
+        printf("handle is null\n");
+        return clip_errcode_invalid_ptr;
+    }
+    if (num <= 0)
+    {
+        printf("invalid roi count %d\n", num);
+        return clip_errcode_invalid_param;
+    }
+
+    std::vector<std::string> keys(num);
+    std::unique_lock<std::shared_mutex> lock(internal_handle->m_gallery_mutex);
+    for (int i = 0; i < num; i++)
+    {
+        char key[CLIP_KEY_MAX_LEN];
+        int len = snprintf(key, sizeof(key), "%s#obj%d", key_prefix, i);
+        if (len >= CLIP_KEY_MAX_LEN)
+        {
+            printf("key %s#obj%d is longer than %d\n", key_prefix, i, CLIP_KEY_MAX_LEN - 1);
+            return clip_errcode_add_failed;
+        }
+        if (!overwrite && find_key(internal_handle, key) >= 0)
+        {
+            printf("key %s already exists\n", key);
+            return clip_errcode_add_failed_key_exist;
+        }
+        keys[i] = key;
+    }
+    lock.unlock();
+
+    SimpleCV::Mat src(image->height, image->width, image->channels, image->data, image->stride);
+    std::vector<clip_rect_t> roi_list(rois, rois + num);
+    std::vector<std::vector<float>> image_features;
+    auto ret = internal_handle->m_clip.encode(src, roi_list, image_features);
+    if (!ret)
+    {
+        printf("encode image failed\n");
+        return clip_errcode_add_failed_encode_image;
+    }
+
+    lock.lock();
+    // another caller may have added one of the keys while the lock was released for the encode
+    for (auto &key : keys)
+    {
+        if (!overwrite && find_key(internal_handle, key.c_str()) >= 0)
+        {
+            printf("key %s already exists\n", key.c_str());
+            return clip_errcode_add_failed_key_exist;
+        }
+    }
+    if (!put_features(internal_handle, keys, image_features))
+    {
+        return clip_errcode_add_failed_push_db;
+    }
+    return clip_errcode_success;
+}
+
+int clip_get_image_feat_rois(clip_handle_t handle, clip_image_t *image, clip_rect_t *rois, int num, clip_feature_item_t *feats)
+{
+    clip_internal_handle_t *internal_handle = (clip_internal_handle_t *)handle;
+    if (internal_handle == nullptr || image == nullptr || rois == nullptr || feats == nullptr)
+    {
+        printf("handle is null\n");
+        return clip_errcode_invalid_ptr;
+    }
+    if (num <= 0)
+    {
+        printf("invalid roi count %d\n", num);
+        return clip_errcode_invalid_param;
+    }
+
+    SimpleCV::Mat src(image->height, image->width, image->channels, image->data, image->stride);
+    std::vector<clip_rect_t> roi_list(rois, rois + num);
+    std::vector<std::vector<float>> image_features;
+    auto ret = internal_handle->m_clip.encode(src, roi_list, image_features);
+    if (!ret)
+    {
+        printf("encode image failed\n");
+        return clip_errcode_match_failed_encode_image;
+    }
+
+    for (int i = 0; i < num; i++)
+    {
+        if (image_features[i].size() > CLIP_TEXT_FEAT_MAX_LEN)
+        {
+            printf("encode image failed, image_features size: %ld > %d\n", image_features[i].size(), CLIP_TEXT_FEAT_MAX_LEN);
+            return clip_errcode_match_failed_encode_image;
+        }
+        memcpy(feats[i].feat, image_features[i].data(), image_features[i].size() * sizeof(float));
+        feats[i].len = image_features[i].size();
+    }
+    return clip_errcode_success;
+}
+
+struct ingest_item_t
+{
+    int index;
+    int status;
+    SimpleCV::Mat image;
+};
+
+int clip_ingest_paths(clip_handle_t handle, const char **paths, int num, clip_ingest_options_t *options, clip_ingest_progress_cb progress_cb)
+{
+    clip_internal_handle_t *internal_handle = (clip_internal_handle_t *)handle;
+    if (internal_handle == nullptr || paths == nullptr)
+    {
+        printf("handle is null\n");
+        return clip_errcode_invalid_ptr;
+    }
+    if (num <= 0)
+    {
+        printf("invalid path count %d\n", num);
+        return clip_errcode_invalid_param;
+    }
+    for (int i = 0; i < num; i++)
+    {
+        if (paths[i] == nullptr)
+        {
+            printf("path %d is null\n", i);
+            return clip_errcode_invalid_ptr;
+        }
+    }
+
+    clip_ingest_options_t opt;
+    memset(&opt, 0, sizeof(opt));
+    if (options)
+    {
+        opt = *options;
+    }
+    if (opt.num_threads <= 0)
+    {
+        opt.num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (opt.queue_depth <= 0)
+    {
+        opt.queue_depth = 2 * opt.num_threads;
+    }
+    if (opt.batch_size <= 0)
+    {
+        opt.batch_size = 8;
+    }
+
+    int first_err = clip_errcode_success;
+    int done = 0;
+    std::vector<std::string> keys(num);
+    auto report = [&](int index, int status)
+    {
+        done++;
+        if (status != clip_errcode_success && status != clip_errcode_add_failed_key_exist && first_err == clip_errcode_success)
+        {
+            first_err = status;
+        }
+        if (progress_cb)
+        {
+            progress_cb(paths[index], keys[index].c_str(), status, done, num, opt.userdata);
+        }
+    };
 
-    auto it = handle->m_db->NewIterator(handle->m_read_options);
-    for (it->SeekToFirst(); it->Valid(); it->Next())
+    std::vector<int> pending;
+    for (int i = 0; i < num; i++)
     {
-        handle->m_keys.push_back(it->key().ToString());
-        std::vector<float> image_features;
-        image_features.resize(it->value().size() / sizeof(float));
-        memcpy(image_features.data(), it->value().data(), it->value().size());
-        handle->m_image_features.push_back(image_features);
-        // printf("key: %s, value size: %ld\n", it->key().ToString().c_str(), it->value().size());
+        keys[i] = std::filesystem::path(paths[i]).filename().string();
+        if (keys[i].size() >= CLIP_KEY_MAX_LEN)
+        {
+            keys[i].resize(CLIP_KEY_MAX_LEN - 1);
+        }
+        bool exists = false;
+        if (!opt.overwrite)
+        {
+            std::shared_lock<std::shared_mutex> lock(internal_handle->m_gallery_mutex);
+            exists = find_key(internal_handle, keys[i].c_str()) >= 0;
+        }
+        if (exists)
+        {
+            report(i, clip_errcode_add_failed_key_exist);
+            continue;
+        }
+        pending.push_back(i);
     }
-    *_handle = handle;
-    return clip_errcode_success;
-}
 
-int clip_destroy(clip_handle_t handle)
-{
-    clip_internal_handle_t *internal_handle = (clip_internal_handle_t *)handle;
-    if (internal_handle)
+    int input_width = internal_handle->m_clip.get_image_input_width();
+    int input_height = internal_handle->m_clip.get_image_input_height();
+
+    BoundedQueue<ingest_item_t> decoded(opt.queue_depth);
+    std::atomic<size_t> next{0};
+    std::atomic<int> running{opt.num_threads};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < opt.num_threads; t++)
     {
-        delete internal_handle;
+        workers.emplace_back([&]()
+                             {
+            while (true)
+            {
+                size_t j = next++;
+                if (j >= pending.size())
+                {
+                    break;
+                }
+                ingest_item_t item;
+                item.index = pending[j];
+                item.status = clip_errcode_success;
+                SimpleCV::Mat src = imread_scaled(paths[item.index], input_width, input_height);
+                if (src.data == nullptr || src.width <= 0 || src.height <= 0)
+                {
+                    item.status = clip_errcode_add_failed_decode_image;
+                }
+                else if (input_width > 0 && input_height > 0)
+                {
+                    SimpleCV::resize(src, item.image, input_width, input_height);
+                }
+                else
+                {
+                    item.image = src;
+                }
+                if (!decoded.push(std::move(item)))
+                {
+                    break;
+                }
+            }
+            if (--running == 0)
+            {
+                decoded.close();
+            } });
     }
-    return clip_errcode_success;
-}
 
-int clip_add(clip_handle_t handle, char key[CLIP_KEY_MAX_LEN], clip_image_t *image, char overwrite)
-{
-    clip_internal_handle_t *internal_handle = (clip_internal_handle_t *)handle;
-    if (internal_handle == nullptr)
+    // one feeder per image encoder instance so replicas / pooled cards all stay busy; helper feeders
+    // hand their results to the calling thread, which is the only one invoking the progress callback
+    int num_feeders = internal_handle->m_clip.get_image_instance_count();
+    std::mutex finished_mutex;
+    std::vector<std::pair<int, int>> finished;
+    auto report_finished = [&]()
     {
-        printf("handle is null\n");
-        return clip_errcode_invalid_ptr;
-    }
+        std::vector<std::pair<int, int>> results;
+        {
+            std::lock_guard<std::mutex> lock(finished_mutex);
+            results.swap(finished);
+        }
+        for (auto &r : results)
+        {
+            report(r.first, r.second);
+        }
+    };
 
-    if (!overwrite)
+    auto feed = [&](bool calling_thread)
     {
-        for (int i = 0; i < internal_handle->m_keys.size(); i++)
+        auto sink = [&](int index, int status)
+        {
+            if (calling_thread)
+            {
+                report(index, status);
+                return;
+            }
+            std::lock_guard<std::mutex> lock(finished_mutex);
+            finished.push_back({index, status});
+        };
+
+        std::vector<ingest_item_t> batch;
+        auto flush = [&]()
         {
-            if (strcmp(internal_handle->m_keys[i].c_str(), key) == 0)
+            if (batch.empty())
+            {
+                return;
+            }
+            int n = batch.size();
+            std::vector<char> key_buf(n * CLIP_KEY_MAX_LEN, 0);
+            std::vector<clip_image_t> images(n);
+            std::vector<int> status(n, clip_errcode_success);
+            for (int i = 0; i < n; i++)
+            {
+                auto &key = keys[batch[i].index];
+                memcpy(&key_buf[i * CLIP_KEY_MAX_LEN], key.c_str(), key.size());
+                auto &img = batch[i].image;
+                images[i].data = img.data;
+                images[i].width = img.width;
+                images[i].height = img.height;
+                images[i].channels = img.channels;
+                images[i].stride = img.step;
+            }
+            clip_add_batch(handle, (char(*)[CLIP_KEY_MAX_LEN])key_buf.data(), images.data(), n, opt.overwrite, status.data());
+            for (int i = 0; i < n; i++)
+            {
+                sink(batch[i].index, status[i]);
+            }
+            batch.clear();
+            if (calling_thread)
             {
-                printf("key already exists\n");
-                return clip_errcode_add_failed_key_exist;
+                report_finished();
             }
+        };
+
+        // take whatever has been decoded, up to batch_size, and hand it to the encoder
+        ingest_item_t item;
+        while (decoded.pop(item))
+        {
+            do
+            {
+                if (item.status != clip_errcode_success)
+                {
+                    sink(item.index, item.status);
+                    continue;
+                }
+                batch.push_back(std::move(item));
+            } while ((int)batch.size() < opt.batch_size && decoded.try_pop(item));
+            flush();
         }
-    }
+    };
 
-    std::vector<float> image_features;
-    auto ret = internal_handle->m_clip.encode(image, image_features);
-    if (!ret)
+    std::vector<std::thread> feeders;
+    for (int f = 1; f < num_feeders; f++)
     {
-        printf("encode image failed\n");
-        return clip_errcode_add_failed_encode_image;
+        feeders.emplace_back(feed, false);
     }
+    feed(true);
+    for (auto &f : feeders)
+    {
+        f.join();
+    }
+    report_finished();
 
-    internal_handle->m_keys.push_back(key);
-    internal_handle->m_image_features.push_back(image_features);
-    leveldb::Slice key_slice(key);
-    leveldb::Slice value_slice((char *)image_features.data(), image_features.size() * sizeof(float));
-    leveldb::Status status = internal_handle->m_db->Put(internal_handle->m_write_options, key_slice, value_slice);
-    if (!status.ok())
+    for (auto &w : workers)
     {
-        printf("put db failed, status: %s\n", status.ToString().c_str());
-        return clip_errcode_add_failed_push_db;
+        w.join();
     }
-    return clip_errcode_success;
+    return first_err;
 }
 
 int clip_remove(clip_handle_t handle, char key[CLIP_KEY_MAX_LEN])
@@ -169,6 +1055,7 @@ int clip_remove(clip_handle_t handle, char key[CLIP_KEY_MAX_LEN])
         printf("handle is null\n");
         return clip_errcode_invalid_ptr;
     }
+    std::unique_lock<std::shared_mutex> lock(internal_handle->m_gallery_mutex);
     int index = -1;
     for (int i = 0; i < internal_handle->m_keys.size(); i++)
     {
@@ -203,6 +1090,7 @@ int clip_contain(clip_handle_t handle, char key[CLIP_KEY_MAX_LEN])
         printf("handle is null\n");
         return clip_errcode_invalid_ptr;
     }
+    std::shared_lock<std::shared_mutex> lock(internal_handle->m_gallery_mutex);
     for (int i = 0; i < internal_handle->m_keys.size(); i++)
     {
         if (strcmp(internal_handle->m_keys[i].c_str(), key) == 0)
@@ -222,26 +1110,105 @@ int clip_get_text_feat(clip_handle_t handle, const char *text, clip_feature_item
         return clip_errcode_invalid_ptr;
     }
     std::vector<std::vector<float>> text_features;
-    std::vector<std::string> texts = {text};
-    auto ret = internal_handle->m_clip.encode(texts, text_features);
-    if (!ret)
+    int ret = get_text_features(internal_handle, {text}, text_features);
+    if (ret != clip_errcode_success)
     {
-        printf("encode text failed\n");
-        return clip_errcode_match_failed_encode_text;
+        return ret;
+    }
+
+    memcpy(feature->feat, text_features[0].data(), text_features[0].size() * sizeof(float));
+    feature->len = text_features[0].size();
+    return clip_errcode_success;
+}
+
+int clip_get_text_feat_from_ids(clip_handle_t handle, const int *ids, int n_ids, clip_feature_item_t *feature)
+{
+    return clip_get_text_feat_from_ids_batch(handle, &ids, &n_ids, 1, feature);
+}
+
+int clip_get_text_feat_from_ids_batch(clip_handle_t handle, const int **ids, const int *n_ids, int num, clip_feature_item_t *feats)
+{
+    clip_internal_handle_t *internal_handle = (clip_internal_handle_t *)handle;
+    if (internal_handle == nullptr || ids == nullptr || n_ids == nullptr || feats == nullptr)
+    {
+        printf("handle is null\n");
+        return clip_errcode_invalid_ptr;
     }
-    if (text_features.size() != 1)
+    if (num <= 0)
     {
-        printf("encode text failed, text_features size: %ld\n", text_features.size());
+        printf("invalid token ids count %d\n", num);
+        return clip_errcode_invalid_param;
+    }
+    // the only place token ids are validated, encode_ids copies them into the model input as they are
+    int vocab_size = internal_handle->m_clip.get_vocab_size();
+    int token_len = internal_handle->m_clip.get_text_token_len();
+    if (token_len <= 0)
+    {
+        printf("text encoder is not available\n");
         return clip_errcode_match_failed_encode_text;
     }
-    if (text_features[0].size() > CLIP_TEXT_FEAT_MAX_LEN)
+    std::vector<std::vector<int>> token_ids(num);
+    for (int i = 0; i < num; i++)
     {
-        printf("encode text failed, text_features size: %ld > %d\n", text_features[0].size(), CLIP_TEXT_FEAT_MAX_LEN);
+        if (ids[i] == nullptr)
+        {
+            printf("token ids %d is null\n", i);
+            return clip_errcode_invalid_ptr;
+        }
+        if (n_ids[i] <= 0 || n_ids[i] > token_len)
+        {
+            printf("token ids %d: length %d not in [1, %d]\n", i, n_ids[i], token_len);
+            return clip_errcode_invalid_param;
+        }
+        for (int j = 0; j < n_ids[i]; j++)
+        {
+            if (ids[i][j] < 0 || ids[i][j] >= vocab_size)
+            {
+                printf("token ids %d: id %d not in [0, %d)\n", i, ids[i][j], vocab_size);
+                return clip_errcode_invalid_param;
+            }
+        }
+        token_ids[i].assign(ids[i], ids[i] + n_ids[i]);
+    }
+    std::vector<std::vector<float>> text_features;
+    if (!internal_handle->m_clip.encode_ids(token_ids, text_features))
+    {
+        printf("encode text failed\n");
         return clip_errcode_match_failed_encode_text;
     }
-    
-    memcpy(feature->feat, text_features[0].data(), text_features[0].size() * sizeof(float));
-    feature->len = text_features[0].size();
+    for (int i = 0; i < num; i++)
+    {
+        if (text_features[i].size() > CLIP_TEXT_FEAT_MAX_LEN)
+        {
+            printf("encode text failed, text_features size: %ld > %d\n", text_features[i].size(), CLIP_TEXT_FEAT_MAX_LEN);
+            return clip_errcode_match_failed_encode_text;
+        }
+        memcpy(feats[i].feat, text_features[i].data(), text_features[i].size() * sizeof(float));
+        feats[i].len = text_features[i].size();
+    }
+    return clip_errcode_success;
+}
+
+int clip_precompute_text_feats(clip_handle_t handle, const char **texts, int num)
+{
+    clip_internal_handle_t *internal_handle = (clip_internal_handle_t *)handle;
+    if (internal_handle == nullptr || texts == nullptr)
+    {
+        printf("handle is null\n");
+        return clip_errcode_invalid_ptr;
+    }
+    // chunked so a long label list does not hold every feature in memory at once
+    const int chunk = 64;
+    for (int offset = 0; offset < num; offset += chunk)
+    {
+        std::vector<std::string> batch(texts + offset, texts + std::min(num, offset + chunk));
+        std::vector<std::vector<float>> text_features;
+        int ret = get_text_features(internal_handle, batch, text_features);
+        if (ret != clip_errcode_success)
+        {
+            return ret;
+        }
+    }
     return clip_errcode_success;
 }
 
@@ -314,6 +1281,7 @@ int clip_match_feat(clip_handle_t handle, clip_feature_item_t *feature, clip_res
         return clip_errcode_invalid_ptr;
     }
 
+    std::shared_lock<std::shared_mutex> lock(internal_handle->m_gallery_mutex);
     std::vector<std::vector<float>> logits_per_image;
     std::vector<std::vector<float>> logits_per_text;
     internal_handle->m_clip.decode(internal_handle->m_image_features, text_features, logits_per_image, logits_per_text);
@@ -353,6 +1321,7 @@ int clip_match_image(clip_handle_t handle, clip_image_t *image, clip_result_item
         return clip_errcode_match_failed_encode_image;
     }
 
+    std::shared_lock<std::shared_mutex> lock(internal_handle->m_gallery_mutex);
     std::vector<float> scores;
     for (auto &feat : internal_handle->m_image_features)
     {
@@ -370,3 +1339,257 @@ int clip_match_image(clip_handle_t handle, clip_image_t *image, clip_result_item
 
     return clip_errcode_success;
 }
+
+int clip_classifier_create(clip_handle_t handle, const char **labels, int num, const char **templates, int num_templates, clip_classifier_t *classifier)
+{
+    clip_internal_handle_t *internal_handle = (clip_internal_handle_t *)handle;
+    if (internal_handle == nullptr || labels == nullptr || classifier == nullptr)
+    {
+        printf("handle is null\n");
+        return clip_errcode_invalid_ptr;
+    }
+    if (num <= 0)
+    {
+        printf("invalid label count %d\n", num);
+        return clip_errcode_invalid_param;
+    }
+    if (templates == nullptr || num_templates <= 0)
+    {
+        static const char *identity_template[] = {"{}"};
+        templates = identity_template;
+        num_templates = 1;
+    }
+
+    std::vector<std::string> label_list(labels, labels + num);
+    std::vector<std::string> prompts;
+    prompts.reserve(num * num_templates);
+    for (auto &label : label_list)
+    {
+        for (int t = 0; t < num_templates; t++)
+        {
+            std::string prompt = templates[t];
+            auto pos = prompt.find("{}");
+            if (pos != std::string::npos)
+            {
+                prompt.replace(pos, 2, label);
+            }
+            prompts.push_back(prompt);
+        }
+    }
+
+    // goes through the text feature cache, so prompts shared between classifiers are encoded once
+    std::vector<std::vector<float>> text_features;
+    if (get_text_features(internal_handle, prompts, text_features) != clip_errcode_success)
+    {
+        printf("encode labels failed\n");
+        return clip_errcode_classifier_failed_encode_text;
+    }
+
+    auto internal_classifier = new clip_internal_classifier_t;
+    internal_classifier->m_handle = internal_handle;
+    if (!internal_classifier->m_classifier.build(label_list, text_features, num_templates, (int)internal_handle->m_clip.get_clip_type()))
+    {
+        delete internal_classifier;
+        return clip_errcode_classifier_failed;
+    }
+    *classifier = internal_classifier;
+    return clip_errcode_success;
+}
+
+int clip_classifier_load(clip_handle_t handle, const char *path, clip_classifier_t *classifier)
+{
+    clip_internal_handle_t *internal_handle = (clip_internal_handle_t *)handle;
+    if (internal_handle == nullptr || path == nullptr || classifier == nullptr)
+    {
+        printf("handle is null\n");
+        return clip_errcode_invalid_ptr;
+    }
+    auto internal_classifier = new clip_internal_classifier_t;
+    internal_classifier->m_handle = internal_handle;
+    if (!internal_classifier->m_classifier.load(path))
+    {
+        delete internal_classifier;
+        return clip_errcode_classifier_failed_io;
+    }
+    auto &c = internal_classifier->m_classifier;
+    if (c.get_clip_type() != (int)internal_handle->m_clip.get_clip_type() || c.get_dim() != internal_handle->m_clip.get_image_feature_size())
+    {
+        printf("classifier %s was built for clip type %d dim %d\n", path, c.get_clip_type(), c.get_dim());
+        delete internal_classifier;
+        return clip_errcode_classifier_failed_mismatch;
+    }
+    *classifier = internal_classifier;
+    return clip_errcode_success;
+}
+
+int clip_classifier_save(clip_classifier_t classifier, const char *path)
+{
+    clip_internal_classifier_t *internal_classifier = (clip_internal_classifier_t *)classifier;
+    if (internal_classifier == nullptr || path == nullptr)
+    {
+        printf("classifier is null\n");
+        return clip_errcode_invalid_ptr;
+    }
+    if (!internal_classifier->m_classifier.save(path))
+    {
+        return clip_errcode_classifier_failed_io;
+    }
+    return clip_errcode_success;
+}
+
+int clip_classifier_destroy(clip_classifier_t classifier)
+{
+    clip_internal_classifier_t *internal_classifier = (clip_internal_classifier_t *)classifier;
+    if (internal_classifier)
+    {
+        delete internal_classifier;
+    }
+    return clip_errcode_success;
+}
+
+int clip_classify_feat(clip_classifier_t classifier, clip_feature_item_t *feat, clip_result_item_t *results, int top_k)
+{
+    clip_internal_classifier_t *internal_classifier = (clip_internal_classifier_t *)classifier;
+    if (internal_classifier == nullptr || feat == nullptr)
+    {
+        printf("classifier is null\n");
+        return clip_errcode_invalid_ptr;
+    }
+    auto &c = internal_classifier->m_classifier;
+    if (feat->len != c.get_dim())
+    {
+        printf("feature len %d != classifier dim %d\n", feat->len, c.get_dim());
+        return clip_errcode_classifier_failed_mismatch;
+    }
+    std::vector<float> scores;
+    c.similarity(feat->feat, scores);
+    internal_classifier->m_handle->m_clip.similarity_to_prob(scores);
+    get_top_k_results(scores, c.get_labels(), results, top_k);
+    return clip_errcode_success;
+}
+
+int clip_classify_image(clip_classifier_t classifier, clip_image_t *image, clip_result_item_t *results, int top_k)
+{
+    clip_internal_classifier_t *internal_classifier = (clip_internal_classifier_t *)classifier;
+    if (internal_classifier == nullptr || image == nullptr)
+    {
+        printf("classifier is null\n");
+        return clip_errcode_invalid_ptr;
+    }
+    auto &c = internal_classifier->m_classifier;
+    std::vector<float> image_features;
+    if (!internal_classifier->m_handle->m_clip.encode(image, image_features))
+    {
+        printf("encode image failed\n");
+        return clip_errcode_match_failed_encode_image;
+    }
+    if ((int)image_features.size() != c.get_dim())
+    {
+        printf("feature len %d != classifier dim %d\n", (int)image_features.size(), c.get_dim());
+        return clip_errcode_classifier_failed_mismatch;
+    }
+    std::vector<float> scores;
+    c.similarity(image_features.data(), scores);
+    internal_classifier->m_handle->m_clip.similarity_to_prob(scores);
+    get_top_k_results(scores, c.get_labels(), results, top_k);
+    return clip_errcode_success;
+}
+
+int clip_get_text_cache_stats(clip_handle_t handle, clip_text_cache_stats_t *stats)
+{
+    clip_internal_handle_t *internal_handle = (clip_internal_handle_t *)handle;
+    if (internal_handle == nullptr || stats == nullptr)
+    {
+        printf("handle is null\n");
+        return clip_errcode_invalid_ptr;
+    }
+    size_t size = 0, capacity = 0;
+    internal_handle->m_text_cache.stats(stats->hits, stats->misses, size, capacity);
+    stats->size = size;
+    stats->capacity = capacity;
+    return clip_errcode_success;
+}
+
+int clip_invalidate_text_cache(clip_handle_t handle)
+{
+    clip_internal_handle_t *internal_handle = (clip_internal_handle_t *)handle;
+    if (internal_handle == nullptr)
+    {
+        printf("handle is null\n");
+        return clip_errcode_invalid_ptr;
+    }
+    internal_handle->m_text_cache.clear();
+    return clip_errcode_success;
+}
+
+int clip_get_npu_core_stats(clip_handle_t handle, clip_npu_core_stats_t *stats, int *num)
+{
+    clip_internal_handle_t *internal_handle = (clip_internal_handle_t *)handle;
+    if (internal_handle == nullptr || num == nullptr)
+    {
+        printf("handle is null\n");
+        return clip_errcode_invalid_ptr;
+    }
+    std::vector<clip_npu_core_stats_t> core_stats;
+    internal_handle->m_clip.get_image_core_stats(core_stats);
+    if (stats != nullptr)
+    {
+        int count = std::min(*num, (int)core_stats.size());
+        for (int i = 0; i < count; i++)
+        {
+            stats[i] = core_stats[i];
+        }
+    }
+    *num = core_stats.size();
+    return clip_errcode_success;
+}
+
+int clip_get_startup_stats(clip_handle_t handle, clip_startup_stats_t *stats)
+{
+    clip_internal_handle_t *internal_handle = (clip_internal_handle_t *)handle;
+    if (internal_handle == nullptr || stats == nullptr)
+    {
+        printf("handle is null\n");
+        return clip_errcode_invalid_ptr;
+    }
+    *stats = internal_handle->m_startup_stats;
+    return clip_errcode_success;
+}
+
+int clip_set_dedup(clip_handle_t handle, clip_dedup_config_t *config)
+{
+    clip_internal_handle_t *internal_handle = (clip_internal_handle_t *)handle;
+    if (internal_handle == nullptr || config == nullptr)
+    {
+        printf("handle is null\n");
+        return clip_errcode_invalid_ptr;
+    }
+    std::unique_lock<std::shared_mutex> lock(internal_handle->m_gallery_mutex);
+    internal_handle->m_dedup_config = *config;
+    if (internal_handle->m_dedup_config.history <= 0)
+    {
+        internal_handle->m_dedup_config.history = 64;
+    }
+    if (internal_handle->m_dedup_config.hamming_threshold < 0)
+    {
+        internal_handle->m_dedup_config.hamming_threshold = 0;
+    }
+    while ((int)internal_handle->m_dedup_history.size() > internal_handle->m_dedup_config.history)
+    {
+        internal_handle->m_dedup_history.pop_front();
+    }
+    return clip_errcode_success;
+}
+
+int clip_get_dedup_stats(clip_handle_t handle, clip_dedup_stats_t *stats)
+{
+    clip_internal_handle_t *internal_handle = (clip_internal_handle_t *)handle;
+    if (internal_handle == nullptr || stats == nullptr)
+    {
+        printf("handle is null\n");
+        return clip_errcode_invalid_ptr;
+    }
+    std::shared_lock<std::shared_mutex> lock(internal_handle->m_gallery_mutex);
+    *stats = internal_handle->m_dedup_stats;
+    return clip_errcode_success;
+}
@@ -6,6 +6,7 @@
 #include <fcntl.h>
 
 #include "ax_api_loader.h"
+#include "../ax_io_pool.hpp"
 
 AxSysApiLoader &get_ax_sys_loader()
 {
@@ -75,12 +76,66 @@ static bool read_file(const std::string &path, std::vector<char> &data)
     return true;
 }
 
+// one CMM slab pool per cache strategy, shared by every model on the host NPU
+static const char *cmm_pool_name(AX_ENGINE_ALLOC_BUFFER_STRATEGY_T strategy)
+{
+    return strategy == AX_ENGINE_ABST_CACHED ? "ax650_cached" : "ax650";
+}
+
+static int cmm_alloc(AX_U64 *phy, AX_VOID **vir, AX_U32 size, AX_ENGINE_ALLOC_BUFFER_STRATEGY_T strategy)
+{
+    if (strategy == AX_ENGINE_ABST_CACHED)
+    {
+        return get_ax_sys_loader().AX_SYS_MemAllocCached(phy, vir, size, AX_CMM_ALIGN_SIZE, (const AX_S8 *)(AX_CMM_SESSION_NAME));
+    }
+    return get_ax_sys_loader().AX_SYS_MemAlloc(phy, vir, size, AX_CMM_ALIGN_SIZE, (const AX_S8 *)(AX_CMM_SESSION_NAME));
+}
+
+// pool_size > 0 carves the buffer out of the shared slab pool, falling back to its own CMM allocation
+static int alloc_io_buffer(AX_ENGINE_IO_BUFFER_T *buffer, AX_U32 size, AX_ENGINE_ALLOC_BUFFER_STRATEGY_T strategy, size_t pool_size)
+{
+    if (pool_size > 0)
+    {
+        auto &pool = ax_io_pool::get(
+            cmm_pool_name(strategy),
+            [strategy](size_t block_size, uint64_t &addr, void *&vir)
+            {
+                AX_U64 phy = 0;
+                int ret = cmm_alloc(&phy, &vir, (AX_U32)block_size, strategy);
+                addr = phy;
+                return ret;
+            },
+            [](uint64_t addr, void *vir)
+            { get_ax_sys_loader().AX_SYS_MemFree(addr, vir); });
+        pool.reserve(pool_size);
+        uint64_t addr = 0;
+        void *vir = nullptr;
+        if (pool.alloc(size, AX_CMM_ALIGN_SIZE, addr, vir) == 0)
+        {
+            buffer->phyAddr = addr;
+            buffer->pVirAddr = vir;
+            return 0;
+        }
+        ALOGW("io pool %s: alloc %u bytes failed, using a dedicated buffer", cmm_pool_name(strategy), size);
+    }
+    return cmm_alloc((AX_U64 *)(&buffer->phyAddr), &buffer->pVirAddr, size, strategy);
+}
+
+static void free_io_buffer(AX_ENGINE_IO_BUFFER_T *pBuf)
+{
+    if (ax_io_pool::release(cmm_pool_name(AX_ENGINE_ABST_DEFAULT), pBuf->phyAddr) ||
+        ax_io_pool::release(cmm_pool_name(AX_ENGINE_ABST_CACHED), pBuf->phyAddr))
+    {
+        return;
+    }
+    get_ax_sys_loader().AX_SYS_MemFree(pBuf->phyAddr, pBuf->pVirAddr);
+}
+
 void free_io_index(AX_ENGINE_IO_BUFFER_T *io_buf, int index)
 {
     for (int i = 0; i < index; ++i)
     {
-        AX_ENGINE_IO_BUFFER_T *pBuf = io_buf + i;
-        get_ax_sys_loader().AX_SYS_MemFree(pBuf->phyAddr, pBuf->pVirAddr);
+        free_io_buffer(io_buf + i);
     }
 }
 
@@ -88,13 +143,11 @@ void free_io(AX_ENGINE_IO_T *io)
 {
     for (size_t j = 0; j < io->nInputSize; ++j)
     {
-        AX_ENGINE_IO_BUFFER_T *pBuf = io->pInputs + j;
-        get_ax_sys_loader().AX_SYS_MemFree(pBuf->phyAddr, pBuf->pVirAddr);
+        free_io_buffer(io->pInputs + j);
     }
     for (size_t j = 0; j < io->nOutputSize; ++j)
     {
-        AX_ENGINE_IO_BUFFER_T *pBuf = io->pOutputs + j;
-        get_ax_sys_loader().AX_SYS_MemFree(pBuf->phyAddr, pBuf->pVirAddr);
+        free_io_buffer(io->pOutputs + j);
     }
     delete[] io->pInputs;
     delete[] io->pOutputs;
@@ -162,7 +215,9 @@ void free_io(AX_ENGINE_IO_T *io)
 //     return 0;
 // }
 
-static inline int prepare_io(AX_ENGINE_IO_INFO_T *info, AX_ENGINE_IO_T *io_data, INPUT_OUTPUT_ALLOC_STRATEGY strategy)
+// input 0 and the outputs are not zero-filled: the encoders write every input 0 row they run and the engine
+// writes the outputs. The other inputs (masks, position ids, ...) may be left for the model to see as zeros.
+static inline int prepare_io(AX_ENGINE_IO_INFO_T *info, AX_ENGINE_IO_T *io_data, INPUT_OUTPUT_ALLOC_STRATEGY strategy, size_t pool_size)
 {
     memset(io_data, 0, sizeof(*io_data));
     io_data->pInputs = new AX_ENGINE_IO_BUFFER_T[info->nInputSize];
@@ -173,22 +228,20 @@ static inline int prepare_io(AX_ENGINE_IO_INFO_T *info, AX_ENGINE_IO_T *io_data,
     {
         auto meta = info->pInputs[i];
         auto buffer = &io_data->pInputs[i];
-        if (strategy.first == AX_ENGINE_ABST_CACHED)
-        {
-            ret = get_ax_sys_loader().AX_SYS_MemAllocCached((AX_U64 *)(&buffer->phyAddr), &buffer->pVirAddr, meta.nSize, AX_CMM_ALIGN_SIZE, (const AX_S8 *)(AX_CMM_SESSION_NAME));
-        }
-        else
-        {
-            ret = get_ax_sys_loader().AX_SYS_MemAlloc((AX_U64 *)(&buffer->phyAddr), &buffer->pVirAddr, meta.nSize, AX_CMM_ALIGN_SIZE, (const AX_S8 *)(AX_CMM_SESSION_NAME));
-        }
+        ret = alloc_io_buffer(buffer, meta.nSize, strategy.first, pool_size);
 
         if (ret != 0)
         {
-            free_io_index(io_data->pInputs, i);
             fprintf(stderr, "Allocate input{%d} { phy: %p, vir: %p, size: %lu Bytes }. fail \n", i, (void *)buffer->phyAddr, buffer->pVirAddr, (long)meta.nSize);
+            free_io_index(io_data->pInputs, i);
+            delete[] io_data->pInputs;
+            memset(io_data, 0, sizeof(*io_data));
             return ret;
         }
-        memset(buffer->pVirAddr, 0, meta.nSize);
+        if (i > 0)
+        {
+            memset(buffer->pVirAddr, 0, meta.nSize);
+        }
         // fprintf(stderr, "Allocate input{%d} { phy: %p, vir: %p, size: %lu Bytes }. \n", i, (void*)buffer->phyAddr, buffer->pVirAddr, (long)meta.nSize);
     }
 
@@ -199,22 +252,17 @@ static inline int prepare_io(AX_ENGINE_IO_INFO_T *info, AX_ENGINE_IO_T *io_data,
         auto meta = info->pOutputs[i];
         auto buffer = &io_data->pOutputs[i];
         buffer->nSize = meta.nSize;
-        if (strategy.second == AX_ENGINE_ABST_CACHED)
-        {
-            ret = get_ax_sys_loader().AX_SYS_MemAllocCached((AX_U64 *)(&buffer->phyAddr), &buffer->pVirAddr, meta.nSize, AX_CMM_ALIGN_SIZE, (const AX_S8 *)(AX_CMM_SESSION_NAME));
-        }
-        else
-        {
-            ret = get_ax_sys_loader().AX_SYS_MemAlloc((AX_U64 *)(&buffer->phyAddr), &buffer->pVirAddr, meta.nSize, AX_CMM_ALIGN_SIZE, (const AX_S8 *)(AX_CMM_SESSION_NAME));
-        }
+        ret = alloc_io_buffer(buffer, meta.nSize, strategy.second, pool_size);
         if (ret != 0)
         {
             fprintf(stderr, "Allocate output{%d} { phy: %p, vir: %p, size: %lu Bytes }. fail \n", i, (void *)buffer->phyAddr, buffer->pVirAddr, (long)meta.nSize);
             free_io_index(io_data->pInputs, io_data->nInputSize);
             free_io_index(io_data->pOutputs, i);
+            delete[] io_data->pInputs;
+            delete[] io_data->pOutputs;
+            memset(io_data, 0, sizeof(*io_data));
             return ret;
         }
-        memset(buffer->pVirAddr, 0, meta.nSize);
         // fprintf(stderr, "Allocate output{%d} { phy: %p, vir: %p, size: %lu Bytes }.\n", i, (void*)buffer->phyAddr, buffer->pVirAddr, (long)meta.nSize);
     }
 
@@ -224,9 +272,9 @@ static inline int prepare_io(AX_ENGINE_IO_INFO_T *info, AX_ENGINE_IO_T *io_data,
 struct ax_joint_runner_ax650_handle_t
 {
     AX_ENGINE_HANDLE handle;
-    AX_ENGINE_CONTEXT_T context;
+    std::vector<AX_ENGINE_CONTEXT_T> contexts; // one per io slot
     std::vector<AX_ENGINE_IO_INFO_T *> io_info;
-    std::vector<AX_ENGINE_IO_T> io_data;
+    std::vector<std::vector<AX_ENGINE_IO_T>> io_data; // [slot][grpid]
 
     int algo_width, algo_height;
     int algo_colorformat;
@@ -238,7 +286,8 @@ int ax_runner_ax650::init(const void *model_data, unsigned int model_size, int d
     {
         return -1;
     }
-    m_handle = new ax_joint_runner_ax650_handle_t;
+    // value-initialized so deinit() after a failed init only releases what was created
+    m_handle = new ax_joint_runner_ax650_handle_t();
     _devid = devid;
     int ret;
 
@@ -259,12 +308,6 @@ int ax_runner_ax650::init(const void *model_data, unsigned int model_size, int d
         ALOGE("AX_ENGINE_CreateContext");
         return ret;
     }
-    ret = get_ax_engine_loader().AX_ENGINE_CreateContextV2(m_handle->handle, &m_handle->context);
-    if (0 != ret)
-    {
-        ALOGE("AX_ENGINE_CreateContextV2");
-        return ret;
-    }
     // fprintf(stdout, "Engine creating context is done.\n");
 
     // 5. set io
@@ -278,10 +321,6 @@ int ax_runner_ax650::init(const void *model_data, unsigned int model_size, int d
     // ALOGI("io_count=%d", io_count);
 
     m_handle->io_info.resize(io_count);
-    m_handle->io_data.resize(io_count);
-    mgroup_input_tensors.resize(io_count);
-    mgroup_output_tensors.resize(io_count);
-
     for (int grpid = 0; grpid < io_count; grpid++)
     {
         AX_ENGINE_IO_INFO_T *io_info = nullptr;
@@ -294,71 +333,80 @@ int ax_runner_ax650::init(const void *model_data, unsigned int model_size, int d
         // print_io_info(io_info);
 
         m_handle->io_info[grpid] = io_info;
+    }
 
-        ret = prepare_io(m_handle->io_info[grpid], &m_handle->io_data[grpid], std::make_pair(AX_ENGINE_ABST_DEFAULT, AX_ENGINE_ABST_CACHED));
+    // every io slot gets its own context and io buffers, the model itself is loaded once
+    m_handle->contexts.resize(m_num_io_slots);
+    m_handle->io_data.resize(m_num_io_slots);
+    mslot_group_input_tensors.assign(m_num_io_slots, std::vector<std::vector<ax_runner_tensor_t>>(io_count));
+    mslot_group_output_tensors.assign(m_num_io_slots, std::vector<std::vector<ax_runner_tensor_t>>(io_count));
+    for (int slot = 0; slot < m_num_io_slots; slot++)
+    {
+        ret = get_ax_engine_loader().AX_ENGINE_CreateContextV2(m_handle->handle, &m_handle->contexts[slot]);
         if (0 != ret)
         {
-            ALOGE("prepare_io grpid=%d", grpid);
+            ALOGE("AX_ENGINE_CreateContextV2 slot=%d", slot);
             return ret;
         }
-    }
 
-    for (size_t grpid = 0; grpid < io_count; grpid++)
-    {
-        auto &io_info = m_handle->io_info[grpid];
-        auto &io_data = m_handle->io_data[grpid];
-        for (size_t i = 0; i < io_info->nOutputSize; i++)
+        m_handle->io_data[slot].resize(io_count);
+        for (int grpid = 0; grpid < io_count; grpid++)
         {
-            ax_runner_tensor_t tensor;
-            tensor.nIdx = i;
-            tensor.sName = std::string(io_info->pOutputs[i].pName);
-            tensor.nSize = io_info->pOutputs[i].nSize;
-            for (size_t j = 0; j < io_info->pOutputs[i].nShapeSize; j++)
+            ret = prepare_io(m_handle->io_info[grpid], &m_handle->io_data[slot][grpid], std::make_pair(AX_ENGINE_ABST_DEFAULT, AX_ENGINE_ABST_CACHED), m_io_pool_size);
+            if (0 != ret)
             {
-                tensor.vShape.push_back(io_info->pOutputs[i].pShape[j]);
+                ALOGE("prepare_io slot=%d grpid=%d", slot, grpid);
+                return ret;
             }
-            // tensor.eColorSpace = ax_color_space_unknown;
-            tensor.phyAddr = io_data.pOutputs[i].phyAddr;
-            tensor.pVirAddr = io_data.pOutputs[i].pVirAddr;
-            mgroup_output_tensors[grpid].push_back(tensor);
         }
 
-        for (size_t i = 0; i < io_info->nInputSize; i++)
+        for (size_t grpid = 0; grpid < io_count; grpid++)
         {
-            ax_runner_tensor_t tensor;
-            tensor.nIdx = i;
-            tensor.sName = std::string(io_info->pInputs[i].pName);
-            tensor.nSize = io_info->pInputs[i].nSize;
-            // switch (io_info->pInputs[i].pExtraMeta->eColorSpace)
-            // {
-            // case AX_ENGINE_CS_NV12:
-            //     tensor.eColorSpace = ax_color_space_nv12;
-            //     break;
-            // case AX_ENGINE_CS_RGB:
-            //     tensor.eColorSpace = ax_color_space_rgb;
-            //     break;
-            // case AX_ENGINE_CS_BGR:
-            //     tensor.eColorSpace = ax_color_space_bgr;
-            //     break;
-            // default:
-            //     ALOGW("unknown model color format");
-            //     tensor.eColorSpace = ax_color_space_unknown;
-            //     break;
-            // }
-            for (size_t j = 0; j < io_info->pInputs[i].nShapeSize; j++)
+            auto &io_info = m_handle->io_info[grpid];
+            auto &io_data = m_handle->io_data[slot][grpid];
+            for (size_t i = 0; i < io_info->nOutputSize; i++)
             {
-                tensor.vShape.push_back(io_info->pInputs[i].pShape[j]);
+                ax_runner_tensor_t tensor;
+                tensor.nIdx = i;
+                tensor.sName = std::string(io_info->pOutputs[i].pName);
+                tensor.nSize = io_info->pOutputs[i].nSize;
+                for (size_t j = 0; j < io_info->pOutputs[i].nShapeSize; j++)
+                {
+                    tensor.vShape.push_back(io_info->pOutputs[i].pShape[j]);
+                }
+                // tensor.eColorSpace = ax_color_space_unknown;
+                tensor.phyAddr = io_data.pOutputs[i].phyAddr;
+                tensor.pVirAddr = io_data.pOutputs[i].pVirAddr;
+                mslot_group_output_tensors[slot][grpid].push_back(tensor);
+            }
+
+            for (size_t i = 0; i < io_info->nInputSize; i++)
+            {
+                ax_runner_tensor_t tensor;
+                tensor.nIdx = i;
+                tensor.sName = std::string(io_info->pInputs[i].pName);
+                tensor.nSize = io_info->pInputs[i].nSize;
+                for (size_t j = 0; j < io_info->pInputs[i].nShapeSize; j++)
+                {
+                    tensor.vShape.push_back(io_info->pInputs[i].pShape[j]);
+                }
+                tensor.phyAddr = io_data.pInputs[i].phyAddr;
+                tensor.pVirAddr = io_data.pInputs[i].pVirAddr;
+                mslot_group_input_tensors[slot][grpid].push_back(tensor);
             }
-            tensor.phyAddr = io_data.pInputs[i].phyAddr;
-            tensor.pVirAddr = io_data.pInputs[i].pVirAddr;
-            mgroup_input_tensors[grpid].push_back(tensor);
-        }
 
-        print_io_info(mgroup_input_tensors[grpid], mgroup_output_tensors[grpid]);
+            if (slot == 0)
+            {
+                print_io_info(mslot_group_input_tensors[slot][grpid], mslot_group_output_tensors[slot][grpid]);
+            }
+        }
     }
 
+    mgroup_input_tensors = mslot_group_input_tensors[0];
+    mgroup_output_tensors = mslot_group_output_tensors[0];
     moutput_tensors = mgroup_output_tensors[0];
     minput_tensors = mgroup_input_tensors[0];
+    reset_slot_pool();
 
     // m_imgproc.set(m_handle->io_data.pInputs[0].phyAddr, m_handle->io_data.pInputs[0].pVirAddr);
     // fprintf(stdout, "Engine alloc io is done. \n");
@@ -368,17 +416,24 @@ int ax_runner_ax650::init(const void *model_data, unsigned int model_size, int d
 
 void ax_runner_ax650::deinit()
 {
+    drain();
     if (m_handle && m_handle->handle)
     {
-        for (size_t i = 0; i < m_handle->io_data.size(); i++)
+        for (auto &slot_io : m_handle->io_data)
         {
-            free_io(&m_handle->io_data[i]);
+            for (auto &io : slot_io)
+            {
+                free_io(&io);
+            }
         }
         get_ax_engine_loader().AX_ENGINE_DestroyHandle(m_handle->handle);
     }
     delete m_handle;
     m_handle = nullptr;
-    get_ax_engine_loader().AX_ENGINE_Deinit();
+    mslot_group_input_tensors.clear();
+    mslot_group_output_tensors.clear();
+    reset_slot_pool();
+    // the engine itself is owned by ax_dev_sys_init / ax_dev_sys_deinit and shared with the other models
 }
 
 int ax_runner_ax650::set_affinity(int id)
@@ -422,7 +477,7 @@ int ax_runner_ax650::set_affinity(int id)
 
 int ax_runner_ax650::inference()
 {
-    int ret = get_ax_engine_loader().AX_ENGINE_RunSync(m_handle->handle, &m_handle->io_data[0]);
+    int ret = get_ax_engine_loader().AX_ENGINE_RunSync(m_handle->handle, &m_handle->io_data[0][0]);
     for (size_t i = 0; i < get_num_outputs(); i++)
     {
         auto &tensor = get_output(i);
@@ -432,12 +487,17 @@ int ax_runner_ax650::inference()
 }
 int ax_runner_ax650::inference(int grpid)
 {
-    int ret = get_ax_engine_loader().AX_ENGINE_RunGroupIOSync(m_handle->handle, m_handle->context, grpid, &m_handle->io_data[grpid]);
+    return inference(grpid, 0);
+}
+
+int ax_runner_ax650::inference(int grpid, int io_slot)
+{
+    int ret = get_ax_engine_loader().AX_ENGINE_RunGroupIOSync(m_handle->handle, m_handle->contexts[io_slot], grpid, &m_handle->io_data[io_slot][grpid]);
 
     for (size_t i = 0; i < get_num_outputs(); i++)
     {
-        auto &tensor = get_output(grpid, i);
+        auto &tensor = get_slot_output(io_slot, grpid, i);
         get_ax_sys_loader().AX_SYS_MinvalidateCache(tensor.phyAddr, tensor.pVirAddr, tensor.nSize);
     }
     return ret;
-}
\ No newline at end of file
+}
@@ -15,4 +15,7 @@ public:
 
     int inference() override;
     int inference(int grpid) override;
+    int inference(int grpid, int io_slot) override;
+
+    // AX_ENGINE only has blocking run calls, so submit()/wait() keep the helper thread default
 };
\ No newline at end of file
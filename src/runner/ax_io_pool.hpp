@@ -0,0 +1,220 @@
+#pragma once
+#include "sample_log.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <algorithm>
+#include <iterator>
+
+// Slab pool for runner io buffers. Instead of one CMM / device allocation per tensor, group and io slot,
+// tensors are carved out of a few large blocks reserved up front, so loading a model costs a couple of
+// allocations and handles coming and going do not fragment device memory. There is one pool per device
+// and memory kind, shared by every runner on it; blocks stay reserved until trim() once they are empty.
+class ax_io_pool
+{
+public:
+    // allocates / frees one backing block, addr is the device (physical) address, vir its CPU mapping if any
+    typedef std::function<int(size_t size, uint64_t &addr, void *&vir)> block_alloc_t;
+    typedef std::function<void(uint64_t addr, void *vir)> block_free_t;
+
+private:
+    struct block_t
+    {
+        uint64_t addr;
+        char *vir;
+        size_t size;
+        size_t used;
+        std::map<size_t, size_t> free_ranges; // offset -> length
+    };
+
+    std::string m_name;
+    block_alloc_t m_alloc;
+    block_free_t m_free;
+    size_t m_block_size = 0;
+
+    std::mutex m_mutex;
+    std::vector<std::unique_ptr<block_t>> m_blocks;
+    std::map<uint64_t, std::pair<block_t *, size_t>> m_allocs; // addr -> (block, length)
+
+    static std::mutex &pools_mutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static std::map<std::string, std::unique_ptr<ax_io_pool>> &pools()
+    {
+        static std::map<std::string, std::unique_ptr<ax_io_pool>> pools;
+        return pools;
+    }
+
+    // first fit inside one block, callers hold m_mutex
+    bool carve(block_t &block, size_t size, size_t align, uint64_t &addr, void *&vir)
+    {
+        for (auto it = block.free_ranges.begin(); it != block.free_ranges.end(); ++it)
+        {
+            size_t begin = it->first;
+            size_t end = it->first + it->second;
+            size_t start = ((block.addr + begin + align - 1) / align) * align - block.addr;
+            if (start + size > end)
+            {
+                continue;
+            }
+            block.free_ranges.erase(it);
+            if (start > begin)
+            {
+                block.free_ranges[begin] = start - begin;
+            }
+            if (start + size < end)
+            {
+                block.free_ranges[start + size] = end - start - size;
+            }
+            block.used += size;
+            addr = block.addr + start;
+            vir = block.vir ? block.vir + start : nullptr;
+            m_allocs[addr] = {&block, size};
+            return true;
+        }
+        return false;
+    }
+
+public:
+    ax_io_pool(const std::string &name, block_alloc_t alloc, block_free_t free)
+        : m_name(name), m_alloc(alloc), m_free(free) {}
+
+    // the pool called name, created with the given block functions on first use
+    static ax_io_pool &get(const std::string &name, block_alloc_t alloc, block_free_t free)
+    {
+        std::lock_guard<std::mutex> lock(pools_mutex());
+        auto &pool = pools()[name];
+        if (!pool)
+        {
+            pool.reset(new ax_io_pool(name, alloc, free));
+        }
+        return *pool;
+    }
+
+    static ax_io_pool *find(const std::string &name)
+    {
+        std::lock_guard<std::mutex> lock(pools_mutex());
+        auto it = pools().find(name);
+        return it == pools().end() ? nullptr : it->second.get();
+    }
+
+    // hands addr back to the pool called name, false when it was not allocated from there
+    static bool release(const std::string &name, uint64_t addr)
+    {
+        auto *pool = find(name);
+        return pool != nullptr && pool->free(addr);
+    }
+
+    // frees the empty blocks of the pool called name, call before the device itself goes away
+    static void trim(const std::string &name)
+    {
+        auto *pool = find(name);
+        if (pool)
+        {
+            pool->trim();
+        }
+    }
+
+    // size of the blocks reserved from now on, a single larger tensor gets a block of its own size
+    void reserve(size_t block_size)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_block_size = std::max(m_block_size, block_size);
+        if (m_blocks.empty() && m_block_size > 0)
+        {
+            uint64_t addr = 0;
+            void *vir = nullptr;
+            if (m_alloc(m_block_size, addr, vir) != 0)
+            {
+                ALOGW("io pool %s: reserve %zu KB failed", m_name.c_str(), m_block_size / 1024);
+                return;
+            }
+            m_blocks.emplace_back(new block_t{addr, (char *)vir, m_block_size, 0, {{0, m_block_size}}});
+            ALOGI("io pool %s: reserved %zu KB", m_name.c_str(), m_block_size / 1024);
+        }
+    }
+
+    int alloc(size_t size, size_t align, uint64_t &addr, void *&vir)
+    {
+        size = ((size + align - 1) / align) * align;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto &block : m_blocks)
+        {
+            if (block->size - block->used >= size && carve(*block, size, align, addr, vir))
+            {
+                return 0;
+            }
+        }
+
+        size_t block_size = std::max(m_block_size, size + align);
+        uint64_t block_addr = 0;
+        void *block_vir = nullptr;
+        int ret = m_alloc(block_size, block_addr, block_vir);
+        if (ret != 0)
+        {
+            return ret;
+        }
+        m_blocks.emplace_back(new block_t{block_addr, (char *)block_vir, block_size, 0, {{0, block_size}}});
+        ALOGI("io pool %s: new block %zu KB, %d blocks", m_name.c_str(), block_size / 1024, (int)m_blocks.size());
+        return carve(*m_blocks.back(), size, align, addr, vir) ? 0 : -1;
+    }
+
+    bool free(uint64_t addr)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_allocs.find(addr);
+        if (it == m_allocs.end())
+        {
+            return false;
+        }
+        block_t &block = *it->second.first;
+        size_t offset = addr - block.addr;
+        size_t length = it->second.second;
+        m_allocs.erase(it);
+        block.used -= length;
+
+        // merge with the free neighbours
+        auto next = block.free_ranges.lower_bound(offset);
+        if (next != block.free_ranges.end() && next->first == offset + length)
+        {
+            length += next->second;
+            next = block.free_ranges.erase(next);
+        }
+        if (next != block.free_ranges.begin())
+        {
+            auto prev = std::prev(next);
+            if (prev->first + prev->second == offset)
+            {
+                prev->second += length;
+                return true;
+            }
+        }
+        block.free_ranges[offset] = length;
+        return true;
+    }
+
+    void trim()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto it = m_blocks.begin(); it != m_blocks.end();)
+        {
+            if ((*it)->used == 0)
+            {
+                m_free((*it)->addr, (*it)->vir);
+                it = m_blocks.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+};
@@ -0,0 +1,116 @@
+#pragma once
+#include "ax_model_runner.hpp"
+#include "sample_log.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <functional>
+#include <filesystem>
+
+// Process-wide table of loaded models. Handles asking for the same model file on the same device with
+// the same runner settings share one runner (engine handle, contexts, io slots); the last reference
+// to go away deinits it. Callers must go through the runner's io slot pool, never a fixed slot.
+class ax_model_registry
+{
+private:
+    struct entry_t
+    {
+        std::weak_ptr<ax_runner_base> runner;
+        std::shared_ptr<std::mutex> loading; // serializes loads of this key only
+    };
+    std::mutex m_mutex;
+    std::map<std::string, entry_t> m_entries;
+
+    ax_model_registry() = default;
+
+    void release(const std::string &key, ax_runner_base *runner)
+    {
+        runner->deinit();
+        delete runner;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_entries.find(key);
+        if (it != m_entries.end() && it->second.runner.expired())
+        {
+            m_entries.erase(it);
+        }
+    }
+
+public:
+    static ax_model_registry &instance()
+    {
+        static ax_model_registry registry;
+        return registry;
+    }
+
+    // identifies a model file by path, size and modification time, so a replaced file is loaded again
+    static std::string make_key(const std::string &path, int dev_type, int devid, const std::string &settings)
+    {
+        std::error_code ec;
+        auto size = std::filesystem::file_size(path, ec);
+        auto mtime = std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+        return std::to_string(dev_type) + ":" + std::to_string(devid) + ":" + path + ":" +
+               std::to_string(ec ? 0 : size) + ":" + std::to_string(ec ? 0 : mtime) + ":" + settings;
+    }
+
+    // shared runner for key, create() is only called when no live runner exists and returns an initialized one or nullptr
+    std::shared_ptr<ax_runner_base> acquire(const std::string &key, const std::function<ax_runner_base *()> &create)
+    {
+        std::shared_ptr<std::mutex> loading;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto &entry = m_entries[key];
+            if (auto runner = entry.runner.lock())
+            {
+                ALOGI("sharing loaded model %s", key.c_str());
+                return runner;
+            }
+            if (!entry.loading)
+            {
+                entry.loading = std::make_shared<std::mutex>();
+            }
+            loading = entry.loading;
+        }
+
+        std::lock_guard<std::mutex> load_lock(*loading);
+        {
+            // another handle may have finished loading it while we waited
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (auto runner = m_entries[key].runner.lock())
+            {
+                ALOGI("sharing loaded model %s", key.c_str());
+                return runner;
+            }
+        }
+
+        ax_runner_base *raw = create();
+        if (raw == nullptr)
+        {
+            // a failed load leaves no entry behind, unless another caller is still waiting to retry it
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_entries.find(key);
+            if (it != m_entries.end() && it->second.runner.expired() && it->second.loading.use_count() <= 2)
+            {
+                m_entries.erase(it);
+            }
+            return nullptr;
+        }
+        std::shared_ptr<ax_runner_base> runner(raw, [this, key](ax_runner_base *r)
+                                               { release(key, r); });
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_entries[key].runner = runner;
+        return runner;
+    }
+
+    int size()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        int live = 0;
+        for (auto &e : m_entries)
+        {
+            live += !e.second.runner.expired();
+        }
+        return live;
+    }
+};
@@ -5,6 +5,11 @@
 #include <map>
 #include <stdexcept>
 #include <cstdint>
+#include <future>
+#include <functional>
+#include <list>
+#include <chrono>
+#include <condition_variable>
 
 typedef struct
 {
@@ -16,6 +21,9 @@ typedef struct
     void *pVirAddr;
 } ax_runner_tensor_t;
 
+// fired once the outputs of a submitted inference are readable, ret is what inference() would have returned
+typedef std::function<void(int ticket, int ret)> ax_runner_callback_t;
+
 class ax_runner_base
 {
 protected:
@@ -33,13 +41,147 @@ protected:
 
     int _devid = 0;
 
+    // io slot s owns its own execution context and io buffers, slot 0 is the tensors above
+    int m_num_io_slots = 1;
+    // block size of the device's io slab pool, 0 = one allocation per tensor
+    size_t m_io_pool_size = 0;
+    std::vector<std::vector<std::vector<ax_runner_tensor_t>>> mslot_group_output_tensors;
+    std::vector<std::vector<std::vector<ax_runner_tensor_t>>> mslot_group_input_tensors;
+
+    std::mutex m_slot_mutex;
+    std::condition_variable m_slot_cv;
+    std::vector<int> m_free_slots{0};
+
+    // filled entries of the leading dim per [slot][grpid], 0 = all
+    std::vector<std::vector<int>> m_valid_batch;
+
+    // bytes of a tensor holding the valid batch, runners that copy io use it to skip the padding
+    int valid_bytes(const ax_runner_tensor_t &tensor, int slot, int grpid)
+    {
+        if (slot >= (int)m_valid_batch.size() || grpid >= (int)m_valid_batch[slot].size() || tensor.vShape.empty())
+        {
+            return tensor.nSize;
+        }
+        int batch = m_valid_batch[slot][grpid];
+        int full = tensor.vShape[0];
+        if (batch <= 0 || batch >= full)
+        {
+            return tensor.nSize;
+        }
+        return tensor.nSize / full * batch;
+    }
+
+    // called by init() once mslot_group_*_tensors is filled, and by deinit()
+    void reset_slot_pool()
+    {
+        std::lock_guard<std::mutex> lock(m_slot_mutex);
+        m_free_slots.clear();
+        int num_slots = mslot_group_input_tensors.empty() ? 1 : (int)mslot_group_input_tensors.size();
+        int num_groups = mslot_group_input_tensors.empty() ? 0 : (int)mslot_group_input_tensors[0].size();
+        m_valid_batch.assign(num_slots, std::vector<int>(num_groups, 0));
+        for (int slot = num_slots - 1; slot >= 0; slot--)
+        {
+            m_free_slots.push_back(slot);
+        }
+    }
+
+    std::mutex m_ticket_mutex;
+    int m_next_ticket = 0;
+    std::map<int, std::future<int>> m_pending;
+    std::list<std::future<void>> m_callbacks;
+
+    int next_ticket()
+    {
+        std::lock_guard<std::mutex> lock(m_ticket_mutex);
+        return m_next_ticket++;
+    }
+
+    // blocks until every outstanding submission has completed, call before releasing io buffers
+    void drain()
+    {
+        std::list<std::future<void>> callbacks;
+        {
+            std::lock_guard<std::mutex> lock(m_ticket_mutex);
+            callbacks.swap(m_callbacks);
+        }
+        for (auto &cb : callbacks)
+        {
+            cb.wait();
+        }
+        std::map<int, std::future<int>> pending;
+        {
+            std::lock_guard<std::mutex> lock(m_ticket_mutex);
+            pending.swap(m_pending);
+        }
+        for (auto &p : pending)
+        {
+            p.second.wait();
+        }
+    }
+
 public:
+    virtual ~ax_runner_base() {}
+
     virtual int init(const void *model_data, unsigned int model_size, int devid) = 0;
 
     virtual void deinit() = 0;
 
     virtual int set_affinity(int id) { return -1; };
 
+    // number of independent io slots the next init() creates, each one costs a context and a copy of the io buffers
+    void set_num_io_slots(int num) { m_num_io_slots = num > 0 ? num : 1; }
+    int get_num_io_slots() { return mslot_group_input_tensors.empty() ? 1 : (int)mslot_group_input_tensors.size(); }
+
+    // carve the io buffers of the next init() out of the device's shared slab pool (see ax_io_pool.hpp),
+    // which reserves blocks of this many bytes; 0 keeps one allocation per tensor
+    void set_io_pool_size(size_t bytes) { m_io_pool_size = bytes; }
+
+    // Take a free io slot, blocking until one is released. Threads sharing the runner each work on
+    // their own slot's tensors and pass it to inference(grpid, io_slot) / submit(grpid, io_slot).
+    int acquire_slot()
+    {
+        std::unique_lock<std::mutex> lock(m_slot_mutex);
+        m_slot_cv.wait(lock, [this]
+                       { return !m_free_slots.empty(); });
+        int slot = m_free_slots.back();
+        m_free_slots.pop_back();
+        return slot;
+    }
+
+    // non-blocking acquire_slot(), -1 when every slot is taken
+    int try_acquire_slot()
+    {
+        std::lock_guard<std::mutex> lock(m_slot_mutex);
+        if (m_free_slots.empty())
+        {
+            return -1;
+        }
+        int slot = m_free_slots.back();
+        m_free_slots.pop_back();
+        return slot;
+    }
+
+    void release_slot(int slot)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_slot_mutex);
+            m_free_slots.push_back(slot);
+        }
+        m_slot_cv.notify_one();
+    }
+
+    // only the first batch entries of the leading dim are filled for the following runs of grpid on slot (0 = all)
+    void set_valid_batch(int slot, int grpid, int batch)
+    {
+        if (slot < (int)m_valid_batch.size() && grpid < (int)m_valid_batch[slot].size())
+        {
+            m_valid_batch[slot][grpid] = batch;
+        }
+    }
+
+    const ax_runner_tensor_t &get_slot_input(int slot, int grpid, int idx) { return mslot_group_input_tensors[slot][grpid][idx]; }
+    const ax_runner_tensor_t &get_slot_output(int slot, int grpid, int idx) { return mslot_group_output_tensors[slot][grpid][idx]; }
+
     int get_num_inputs() { return minput_tensors.size(); };
     int get_num_outputs() { return moutput_tensors.size(); };
 
@@ -146,6 +288,61 @@ public:
 
     virtual int inference() = 0;
     virtual int inference(int grpid) = 0;
+    virtual int inference(int grpid, int io_slot) { return io_slot == 0 ? inference(grpid) : -1; }
+
+    // Queue an inference of shape group grpid on io slot io_slot and return a ticket (>= 0), or -1 on failure.
+    // The slot's input and output tensors belong to the runner until the ticket is waited.
+    // The default runs the blocking inference(grpid, io_slot) on a helper thread.
+    virtual int submit(int grpid, int io_slot = 0)
+    {
+        if (io_slot < 0 || io_slot >= get_num_io_slots() || grpid < 0 || grpid >= get_num_input_groups())
+        {
+            return -1;
+        }
+        std::lock_guard<std::mutex> lock(m_ticket_mutex);
+        int ticket = m_next_ticket++;
+        m_pending[ticket] = std::async(std::launch::async, [this, grpid, io_slot]
+                                       { return inference(grpid, io_slot); });
+        return ticket;
+    }
+
+    // Block until the ticket completes; each ticket can be waited once. Returns -1 for an unknown ticket.
+    virtual int wait(int ticket)
+    {
+        std::future<int> result;
+        {
+            std::lock_guard<std::mutex> lock(m_ticket_mutex);
+            auto it = m_pending.find(ticket);
+            if (it == m_pending.end())
+            {
+                return -1;
+            }
+            result = std::move(it->second);
+            m_pending.erase(it);
+        }
+        return result.get();
+    }
+
+    // Same as submit() but cb runs on a helper thread when the ticket completes; do not wait() such a ticket.
+    int submit(int grpid, int io_slot, ax_runner_callback_t cb)
+    {
+        int ticket = submit(grpid, io_slot);
+        if (ticket < 0)
+        {
+            return ticket;
+        }
+        std::lock_guard<std::mutex> lock(m_ticket_mutex);
+        m_callbacks.remove_if([](std::future<void> &f)
+                              { return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready; });
+        m_callbacks.push_back(std::async(std::launch::async, [this, ticket, cb]
+                                         {
+                                             int ret = wait(ticket);
+                                             if (cb)
+                                             {
+                                                 cb(ticket, ret);
+                                             } }));
+        return ticket;
+    }
 
     int operator()()
     {
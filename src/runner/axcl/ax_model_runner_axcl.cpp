@@ -7,6 +7,7 @@
 #include <fcntl.h>
 // #include <axcl.h>
 #include "axcl_manager.h"
+#include "../ax_io_pool.hpp"
 
 // #include <opencv2/opencv.hpp>
 
@@ -71,7 +72,8 @@ typedef struct
     int nIndex;
     int nSize;
     void *pBuf;
-    void *pVirAddr;
+    void *pVirAddr; // host mirror, pinned when axcl_MallocHost succeeds
+    bool bPinned;
 
     std::string Name;
 
@@ -86,29 +88,117 @@ typedef struct
     AXCL_IO_BUF_T *pOutputs;
 } AXCL_IO_DATA_T;
 
-static void free_io_index(AXCL_IO_BUF_T *pBuf, size_t index, int _devid)
+// pinned host memory lets the PCIe copies DMA straight from/to the buffer the encoders fill
+static void *alloc_host(size_t size, bool &pinned, int devid, bool zero = false)
 {
-    for (size_t i = 0; i < index; ++i)
+    void *ptr = nullptr;
+    pinned = axcl_MallocHost(&ptr, size, devid) == 0 && ptr != nullptr;
+    if (!pinned)
+    {
+        ptr = malloc(size);
+    }
+    if (zero && ptr)
     {
-        axcl_Free(pBuf[i].pBuf, _devid);
+        memset(ptr, 0, size);
     }
+    return ptr;
 }
 
-static void free_io(AXCL_IO_DATA_T *io_data, int _devid)
+#define AXCL_IO_ALIGN_SIZE 128
+
+// one device memory slab pool per card, shared by every model on it
+static std::string dev_pool_name(int devid)
+{
+    return "axcl:" + std::to_string(devid);
+}
+
+// pool_size > 0 carves the buffer out of the card's slab pool, falling back to its own device allocation
+static axclError alloc_dev(void **devPtr, size_t size, AX_ENGINE_ALLOC_BUFFER_STRATEGY_T strategy, size_t pool_size, int devid)
+{
+    if (pool_size > 0 && strategy == AX_ENGINE_ABST_DEFAULT)
+    {
+        auto &pool = ax_io_pool::get(
+            dev_pool_name(devid),
+            [devid](size_t block_size, uint64_t &addr, void *&vir)
+            {
+                void *ptr = nullptr;
+                int ret = axcl_Malloc(&ptr, block_size, axclrtMemMallocPolicy::AXCL_MEM_MALLOC_HUGE_FIRST, devid);
+                addr = (uint64_t)ptr;
+                vir = nullptr;
+                return ret;
+            },
+            [devid](uint64_t addr, void *vir)
+            { axcl_Free((void *)addr, devid); });
+        pool.reserve(pool_size);
+        uint64_t addr = 0;
+        void *vir = nullptr;
+        if (pool.alloc(size, AXCL_IO_ALIGN_SIZE, addr, vir) == 0)
+        {
+            *devPtr = (void *)addr;
+            return 0;
+        }
+        ALOGW("io pool %s: alloc %zu bytes failed, using a dedicated buffer", dev_pool_name(devid).c_str(), size);
+    }
+    if (strategy == AX_ENGINE_ABST_DEFAULT)
+    {
+        return axcl_Malloc(devPtr, size, axclrtMemMallocPolicy::AXCL_MEM_MALLOC_HUGE_FIRST, devid);
+    }
+    return axcl_MallocCached(devPtr, size, axclrtMemMallocPolicy::AXCL_MEM_MALLOC_HUGE_FIRST, devid);
+}
+
+static void free_dev(void *devPtr, int devid)
+{
+    if (devPtr == nullptr)
+    {
+        return;
+    }
+    if (!ax_io_pool::release(dev_pool_name(devid), (uint64_t)devPtr))
+    {
+        axcl_Free(devPtr, devid);
+    }
+}
+
+static void free_host(AXCL_IO_BUF_T &buf, int devid)
 {
-    for (size_t j = 0; j < io_data->nInputSize; ++j)
+    if (buf.pVirAddr == nullptr)
+    {
+        return;
+    }
+    if (buf.bPinned)
+    {
+        axcl_FreeHost(buf.pVirAddr, devid);
+    }
+    else
     {
-        axcl_Free(io_data->pInputs[j].pBuf, _devid);
+        free(buf.pVirAddr);
     }
-    for (size_t j = 0; j < io_data->nOutputSize; ++j)
+    buf.pVirAddr = nullptr;
+}
+
+// buffers are cleared once released, so the free_io() after a failed prepare_io() does not free them twice
+static void free_io_index(AXCL_IO_BUF_T *pBuf, size_t index, int _devid)
+{
+    for (size_t i = 0; i < index; ++i)
     {
-        axcl_Free(io_data->pOutputs[j].pBuf, _devid);
+        free_dev(pBuf[i].pBuf, _devid);
+        pBuf[i].pBuf = nullptr;
+        free_host(pBuf[i], _devid);
     }
+}
+
+static void free_io(AXCL_IO_DATA_T *io_data, int _devid)
+{
+    free_io_index(io_data->pInputs, io_data->nInputSize, _devid);
+    free_io_index(io_data->pOutputs, io_data->nOutputSize, _devid);
     delete[] io_data->pInputs;
     delete[] io_data->pOutputs;
+    memset(io_data, 0, sizeof(AXCL_IO_DATA_T));
 }
 
-static inline int prepare_io(int grpid, axclrtEngineIOInfo io_info, axclrtEngineIO io, AXCL_IO_DATA_T *io_data, INPUT_OUTPUT_ALLOC_STRATEGY strategy, int devid)
+// input 0 and the outputs are not zero-filled: the encoders write every input 0 row they run and the engine
+// writes the outputs. The other inputs (masks, position ids, ...) may be left for the model to see as zeros,
+// so they and their host mirrors are cleared once here, the device side by copying up the zeroed mirror.
+static inline int prepare_io(int grpid, axclrtEngineIOInfo io_info, axclrtEngineIO io, AXCL_IO_DATA_T *io_data, INPUT_OUTPUT_ALLOC_STRATEGY strategy, size_t pool_size, int devid)
 {
     memset(io_data, 0, sizeof(AXCL_IO_DATA_T));
 
@@ -116,23 +206,15 @@ static inline int prepare_io(int grpid, axclrtEngineIOInfo io_info, axclrtEngine
     auto outputNum = axcl_EngineGetNumOutputs(io_info, devid);
     io_data->nInputSize = inputNum;
     io_data->nOutputSize = outputNum;
-    io_data->pInputs = new AXCL_IO_BUF_T[inputNum];
-    io_data->pOutputs = new AXCL_IO_BUF_T[outputNum];
+    io_data->pInputs = new AXCL_IO_BUF_T[inputNum]();
+    io_data->pOutputs = new AXCL_IO_BUF_T[outputNum]();
 
     // 1. alloc inputs
     for (uint32_t i = 0; i < inputNum; i++)
     {
         auto bufSize = axcl_EngineGetInputSizeByIndex(io_info, grpid, i, devid);
         void *devPtr = nullptr;
-        axclError ret = 0;
-        if (AX_ENGINE_ABST_DEFAULT == strategy.first)
-        {
-            ret = axcl_Malloc(&devPtr, bufSize, axclrtMemMallocPolicy::AXCL_MEM_MALLOC_HUGE_FIRST, devid);
-        }
-        else
-        {
-            ret = axcl_MallocCached(&devPtr, bufSize, axclrtMemMallocPolicy::AXCL_MEM_MALLOC_HUGE_FIRST, devid);
-        }
+        axclError ret = alloc_dev(&devPtr, bufSize, strategy.first, pool_size, devid);
 
         if (ret != 0)
         {
@@ -140,9 +222,6 @@ static inline int prepare_io(int grpid, axclrtEngineIOInfo io_info, axclrtEngine
             ALOGE("Malloc input(index: %d, size: %ld) failed! ret=0x%x", i, bufSize, ret);
             return -1;
         }
-        std::vector<char> tmp(bufSize, 0);
-        axcl_Memcpy(devPtr, tmp.data(), bufSize, axclrtMemcpyKind::AXCL_MEMCPY_HOST_TO_DEVICE, devid);
-        // axclrtMemset(devPtr, 0, bufSize);
 
         axclrtEngineIODims dims;
         ret = axcl_EngineGetInputDims(io_info, grpid, i, &dims, devid);
@@ -158,8 +237,17 @@ static inline int prepare_io(int grpid, axclrtEngineIOInfo io_info, axclrtEngine
         io_data->pInputs[i].pBuf = devPtr;
         io_data->pInputs[i].dims = dims;
         io_data->pInputs[i].Name = axcl_EngineGetInputNameByIndex(io_info, i, devid);
-        io_data->pInputs[i].pVirAddr = malloc(bufSize);
-        memset(io_data->pInputs[i].pVirAddr, 0, bufSize);
+        io_data->pInputs[i].pVirAddr = alloc_host(bufSize, io_data->pInputs[i].bPinned, devid, i > 0);
+        if (i > 0 && io_data->pInputs[i].pVirAddr)
+        {
+            ret = axcl_Memcpy(devPtr, io_data->pInputs[i].pVirAddr, bufSize, axclrtMemcpyKind::AXCL_MEMCPY_HOST_TO_DEVICE, devid);
+            if (ret != 0)
+            {
+                free_io_index(io_data->pInputs, i, devid);
+                ALOGE("Clear input(index: %d, size: %lu) failed! ret=0x%x", i, bufSize, ret);
+                return -1;
+            }
+        }
         ret = axcl_EngineSetInputBufferByIndex(io, i, devPtr, bufSize, devid);
         if (ret != 0)
         {
@@ -174,15 +262,7 @@ static inline int prepare_io(int grpid, axclrtEngineIOInfo io_info, axclrtEngine
     {
         auto bufSize = axcl_EngineGetOutputSizeByIndex(io_info, grpid, i, devid);
         void *devPtr = NULL;
-        axclError ret = 0;
-        if (AX_ENGINE_ABST_DEFAULT == strategy.first)
-        {
-            ret = axcl_Malloc(&devPtr, bufSize, axclrtMemMallocPolicy::AXCL_MEM_MALLOC_HUGE_FIRST, devid);
-        }
-        else
-        {
-            ret = axcl_MallocCached(&devPtr, bufSize, axclrtMemMallocPolicy::AXCL_MEM_MALLOC_HUGE_FIRST, devid);
-        }
+        axclError ret = alloc_dev(&devPtr, bufSize, strategy.second, pool_size, devid);
 
         if (ret != 0)
         {
@@ -190,8 +270,6 @@ static inline int prepare_io(int grpid, axclrtEngineIOInfo io_info, axclrtEngine
             ALOGE("Malloc output(index: %d, size: %ld) failed! ret=0x%x", i, bufSize, ret);
             return -1;
         }
-        std::vector<char> tmp(bufSize, 0);
-        axcl_Memcpy(devPtr, tmp.data(), bufSize, axclrtMemcpyKind::AXCL_MEMCPY_HOST_TO_DEVICE, devid);
         axclrtEngineIODims dims;
         ret = axcl_EngineGetOutputDims(io_info, grpid, i, &dims, devid);
         if (ret != 0)
@@ -206,8 +284,7 @@ static inline int prepare_io(int grpid, axclrtEngineIOInfo io_info, axclrtEngine
         io_data->pOutputs[i].pBuf = devPtr;
         io_data->pOutputs[i].dims = dims;
         io_data->pOutputs[i].Name = axcl_EngineGetOutputNameByIndex(io_info, i, devid);
-        io_data->pOutputs[i].pVirAddr = malloc(bufSize);
-        memset(io_data->pOutputs[i].pVirAddr, 0, bufSize);
+        io_data->pOutputs[i].pVirAddr = alloc_host(bufSize, io_data->pOutputs[i].bPinned, devid);
         ret = axcl_EngineSetOutputBufferByIndex(io, i, devPtr, bufSize, devid);
         if (ret != 0)
         {
@@ -223,29 +300,57 @@ static inline int prepare_io(int grpid, axclrtEngineIOInfo io_info, axclrtEngine
 struct ax_joint_runner_axcl_handle_t
 {
     uint64_t handle = 0;
-    uint64_t context = 0;
     axclrtEngineIOInfo io_info = 0;
-    std::vector<axclrtEngineIO> ios;
-    std::vector<AXCL_IO_DATA_T> io_datas;
+    // per io slot: own context, io buffers for every group and a stream created on the first submit()
+    std::vector<uint64_t> contexts;
+    std::vector<std::vector<axclrtEngineIO>> ios;          // [slot][grpid]
+    std::vector<std::vector<AXCL_IO_DATA_T>> io_datas;     // [slot][grpid]
+    std::vector<axclrtStream> streams;
 
     // int algo_width, algo_height;
     // int algo_colorformat;
 };
 
-int ax_runner_axcl::sub_init()
+static void tensors_from_io(AXCL_IO_DATA_T &io_data, std::vector<ax_runner_tensor_t> &inputs, std::vector<ax_runner_tensor_t> &outputs)
 {
-    // 4. create context
-    int ret = axcl_EngineCreateContext(m_handle->handle, &m_handle->context, _devid);
-    if (0 != ret)
+    for (uint32_t i = 0; i < io_data.nOutputSize; i++)
     {
-        ALOGE("axclrtEngineCreateContext failed.");
-        return ret;
+        ax_runner_tensor_t tensor;
+        tensor.nIdx = i;
+        tensor.sName = std::string(io_data.pOutputs[i].Name);
+        tensor.nSize = io_data.pOutputs[i].nSize;
+        for (int32_t j = 0; j < io_data.pOutputs[i].dims.dimCount; j++)
+        {
+            tensor.vShape.push_back(io_data.pOutputs[i].dims.dims[j]);
+        }
+        // tensor.eColorSpace = ax_color_space_unknown;
+        tensor.phyAddr = (unsigned long long)io_data.pOutputs[i].pBuf;
+        tensor.pVirAddr = io_data.pOutputs[i].pVirAddr;
+        outputs.push_back(tensor);
     }
-    // fprintf(stdout, "axclrtEngineCreateContextt is done. \n");
 
-    // 5. set io
+    for (size_t i = 0; i < io_data.nInputSize; i++)
+    {
+        ax_runner_tensor_t tensor;
+        tensor.nIdx = i;
+        tensor.sName = std::string(io_data.pInputs[i].Name);
+        tensor.nSize = io_data.pInputs[i].nSize;
+        for (int32_t j = 0; j < io_data.pInputs[i].dims.dimCount; j++)
+        {
+            tensor.vShape.push_back(io_data.pInputs[i].dims.dims[j]);
+        }
+        // tensor.eColorSpace = ax_color_space_unknown;
+        tensor.phyAddr = (unsigned long long)io_data.pInputs[i].pBuf;
+        tensor.pVirAddr = io_data.pInputs[i].pVirAddr;
+        inputs.push_back(tensor);
+    }
+}
 
-    ret = axcl_EngineGetIOInfo(m_handle->handle, &m_handle->io_info, _devid);
+int ax_runner_axcl::sub_init()
+{
+    // 4. set io
+
+    int ret = axcl_EngineGetIOInfo(m_handle->handle, &m_handle->io_info, _devid);
     if (0 != ret)
     {
         ALOGE("axclrtEngineGetIOInfo failed.");
@@ -257,82 +362,68 @@ int ax_runner_axcl::sub_init()
     if (ret != 0)
     {
         axcl_EngineUnload(m_handle->handle, _devid);
+        m_handle->handle = 0;
         return ret;
     }
 
-    // 6. alloc io
-
-    m_handle->ios.resize(group_count);
-    m_handle->io_datas.resize(group_count);
-    mgroup_input_tensors.resize(group_count);
-    mgroup_output_tensors.resize(group_count);
+    // 5. create a context and alloc io for every slot, the model itself is loaded once
 
-    memset(&m_handle->io_datas[0], 0, sizeof(AXCL_IO_DATA_T) * group_count);
+    m_handle->contexts.assign(m_num_io_slots, 0);
+    m_handle->streams.assign(m_num_io_slots, nullptr);
+    m_handle->ios.assign(m_num_io_slots, std::vector<axclrtEngineIO>(group_count));
+    m_handle->io_datas.resize(m_num_io_slots);
+    mslot_group_input_tensors.assign(m_num_io_slots, std::vector<std::vector<ax_runner_tensor_t>>(group_count));
+    mslot_group_output_tensors.assign(m_num_io_slots, std::vector<std::vector<ax_runner_tensor_t>>(group_count));
 
     auto malloc_strategy = std::make_pair(AX_ENGINE_ABST_DEFAULT, AX_ENGINE_ABST_DEFAULT);
 
-    for (int grpid = 0; grpid < group_count; grpid++)
+    for (int slot = 0; slot < m_num_io_slots; slot++)
     {
-        ret = axcl_EngineCreateIO(m_handle->io_info, &m_handle->ios[grpid], _devid);
-        if (ret != 0)
-        {
-            axcl_EngineUnload(m_handle->handle, _devid);
-            ALOGE("Create io failed. ret=0x%x", ret);
-            return -1;
-        }
-
-        ret = prepare_io(grpid, m_handle->io_info, m_handle->ios[grpid], &m_handle->io_datas[grpid], malloc_strategy, _devid);
-        if (ret != 0)
+        ret = axcl_EngineCreateContext(m_handle->handle, &m_handle->contexts[slot], _devid);
+        if (0 != ret)
         {
-            free_io(&m_handle->io_datas[grpid], _devid);
-            axcl_EngineDestroyIO(m_handle->ios[grpid], _devid);
-            axcl_EngineUnload(m_handle->handle, _devid);
-
-            ALOGE("prepare_io failed.");
+            ALOGE("axclrtEngineCreateContext failed. slot=%d", slot);
             return ret;
         }
-    }
 
-    for (int grpid = 0; grpid < group_count; grpid++)
-    {
-        // auto &io_info = m_handle->io_info[grpid];
-        auto &io_data = m_handle->io_datas[grpid];
-        for (uint32_t i = 0; i < io_data.nOutputSize; i++)
+        auto &io_datas = m_handle->io_datas[slot];
+        io_datas.resize(group_count);
+        memset(&io_datas[0], 0, sizeof(AXCL_IO_DATA_T) * group_count);
+
+        for (int grpid = 0; grpid < group_count; grpid++)
         {
-            ax_runner_tensor_t tensor;
-            tensor.nIdx = i;
-            tensor.sName = std::string(io_data.pOutputs[i].Name);
-            tensor.nSize = io_data.pOutputs[i].nSize;
-            for (int32_t j = 0; j < io_data.pOutputs[i].dims.dimCount; j++)
+            ret = axcl_EngineCreateIO(m_handle->io_info, &m_handle->ios[slot][grpid], _devid);
+            if (ret != 0)
             {
-                tensor.vShape.push_back(io_data.pOutputs[i].dims.dims[j]);
+                ALOGE("Create io failed. ret=0x%x", ret);
+                return -1;
             }
-            // tensor.eColorSpace = ax_color_space_unknown;
-            tensor.phyAddr = (unsigned long long)io_data.pOutputs[i].pBuf;
-            tensor.pVirAddr = io_data.pOutputs[i].pVirAddr;
-            mgroup_output_tensors[grpid].push_back(tensor);
-        }
 
-        for (size_t i = 0; i < io_data.nInputSize; i++)
-        {
-            ax_runner_tensor_t tensor;
-            tensor.nIdx = i;
-            tensor.sName = std::string(io_data.pInputs[i].Name);
-            tensor.nSize = io_data.pInputs[i].nSize;
-            for (int32_t j = 0; j < io_data.pInputs[i].dims.dimCount; j++)
+            ret = prepare_io(grpid, m_handle->io_info, m_handle->ios[slot][grpid], &io_datas[grpid], malloc_strategy, m_io_pool_size, _devid);
+            if (ret != 0)
             {
-                tensor.vShape.push_back(io_data.pInputs[i].dims.dims[j]);
+                // the buffers of earlier slots / groups and the model itself are released by deinit()
+                free_io(&io_datas[grpid], _devid);
+                axcl_EngineDestroyIO(m_handle->ios[slot][grpid], _devid);
+                m_handle->ios[slot][grpid] = 0;
+
+                ALOGE("prepare_io failed.");
+                return ret;
+            }
+
+            tensors_from_io(io_datas[grpid], mslot_group_input_tensors[slot][grpid], mslot_group_output_tensors[slot][grpid]);
+            if (slot == 0)
+            {
+                print_io_info(mslot_group_input_tensors[slot][grpid], mslot_group_output_tensors[slot][grpid]);
             }
-            // tensor.eColorSpace = ax_color_space_unknown;
-            tensor.phyAddr = (unsigned long long)io_data.pInputs[i].pBuf;
-            tensor.pVirAddr = io_data.pInputs[i].pVirAddr;
-            mgroup_input_tensors[grpid].push_back(tensor);
         }
-        print_io_info(mgroup_input_tensors[grpid], mgroup_output_tensors[grpid]);
     }
 
+    mgroup_input_tensors = mslot_group_input_tensors[0];
+    mgroup_output_tensors = mslot_group_output_tensors[0];
     moutput_tensors = mgroup_output_tensors[0];
     minput_tensors = mgroup_input_tensors[0];
+    reset_slot_pool();
 
     // for (int grpid = 0; grpid < group_count; grpid++)
     // {
@@ -350,7 +441,6 @@ int ax_runner_axcl::init(const void *model_data, unsigned int model_size, int de
     {
         m_handle = new ax_joint_runner_axcl_handle_t;
     }
-    memset((void *)m_handle, 0, sizeof(ax_joint_runner_axcl_handle_t));
 
     _devid = devid;
 
@@ -374,14 +464,42 @@ int ax_runner_axcl::init(const void *model_data, unsigned int model_size, int de
 
 void ax_runner_axcl::deinit()
 {
-    if (m_handle && m_handle->handle)
+    drain();
+    if (m_handle)
     {
-        for (int grpid = 0; grpid < group_count; grpid++)
+        for (auto &stream : m_handle->streams)
+        {
+            if (stream)
+            {
+                axcl_SynchronizeStream(stream, _devid);
+                axcl_DestroyStream(stream, _devid);
+                stream = nullptr;
+            }
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_ticket_mutex);
+        m_stream_tickets.clear();
+    }
+
+    if (m_handle)
+    {
+        for (size_t slot = 0; slot < m_handle->io_datas.size(); slot++)
         {
-            free_io(&m_handle->io_datas[grpid], _devid);
-            axcl_EngineDestroyIO(m_handle->ios[grpid], _devid);
+            for (size_t grpid = 0; grpid < m_handle->io_datas[slot].size(); grpid++)
+            {
+                free_io(&m_handle->io_datas[slot][grpid], _devid);
+                if (m_handle->ios[slot][grpid])
+                {
+                    axcl_EngineDestroyIO(m_handle->ios[slot][grpid], _devid);
+                    m_handle->ios[slot][grpid] = 0;
+                }
+            }
         }
+    }
 
+    if (m_handle && m_handle->handle)
+    {
         axcl_EngineUnload(m_handle->handle, _devid);
         m_handle->handle = 0;
     }
@@ -403,6 +521,10 @@ void ax_runner_axcl::deinit()
 
     map_group_input_tensors.clear();
     map_group_output_tensors.clear();
+
+    mslot_group_input_tensors.clear();
+    mslot_group_output_tensors.clear();
+    reset_slot_pool();
 }
 
 int ax_runner_axcl::set_affinity(int id)
@@ -412,21 +534,21 @@ int ax_runner_axcl::set_affinity(int id)
 
 int ax_runner_axcl::set_input(int grpid, int idx, unsigned long long int phy_addr, unsigned long size)
 {
-    return axcl_EngineSetInputBufferByIndex(m_handle->ios[grpid], idx, (void *)phy_addr, size, _devid);
+    return axcl_EngineSetInputBufferByIndex(m_handle->ios[0][grpid], idx, (void *)phy_addr, size, _devid);
 }
 int ax_runner_axcl::set_output(int grpid, int idx, unsigned long long int phy_addr, unsigned long size)
 {
-    return axcl_EngineSetOutputBufferByIndex(m_handle->ios[grpid], idx, (void *)phy_addr, size, _devid);
+    return axcl_EngineSetOutputBufferByIndex(m_handle->ios[0][grpid], idx, (void *)phy_addr, size, _devid);
 }
 
 int ax_runner_axcl::set_input(int grpid, std::string name, unsigned long long int phy_addr, unsigned long size)
 {
-    return axcl_EngineSetInputBufferByIndex(m_handle->ios[grpid], get_input(grpid, name).nIdx, (void *)phy_addr, size, _devid);
+    return axcl_EngineSetInputBufferByIndex(m_handle->ios[0][grpid], get_input(grpid, name).nIdx, (void *)phy_addr, size, _devid);
 }
 
 int ax_runner_axcl::set_output(int grpid, std::string name, unsigned long long int phy_addr, unsigned long size)
 {
-    return axcl_EngineSetOutputBufferByIndex(m_handle->ios[grpid], get_output(grpid, name).nIdx, (void *)phy_addr, size, _devid);
+    return axcl_EngineSetOutputBufferByIndex(m_handle->ios[0][grpid], get_output(grpid, name).nIdx, (void *)phy_addr, size, _devid);
 }
 
 int ax_runner_axcl::inference()
@@ -434,44 +556,196 @@ int ax_runner_axcl::inference()
     return inference(0);
 }
 
+int ax_runner_axcl::sync_inputs(int grpid, int io_slot)
+{
+    auto &inputs = mslot_group_input_tensors[io_slot][grpid];
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        auto r = axcl_Memcpy((void *)inputs[i].phyAddr,
+                             inputs[i].pVirAddr,
+                             valid_bytes(inputs[i], io_slot, grpid),
+                             AXCL_MEMCPY_HOST_TO_DEVICE,
+                             _devid);
+        if (r != 0)
+        {
+            fprintf(stderr, "axcl_Memcpy H2D failed. grpid=%d idx=%zu size=%d ret=0x%x\n",
+                    grpid, i, inputs[i].nSize, r);
+            return r;
+        }
+    }
+    return 0;
+}
+
+int ax_runner_axcl::sync_outputs(int grpid, int io_slot)
+{
+    auto &outputs = mslot_group_output_tensors[io_slot][grpid];
+    for (size_t i = 0; i < outputs.size(); i++)
+    {
+        auto r = axcl_Memcpy(outputs[i].pVirAddr,
+                             (void *)outputs[i].phyAddr,
+                             valid_bytes(outputs[i], io_slot, grpid),
+                             AXCL_MEMCPY_DEVICE_TO_HOST,
+                             _devid);
+        if (r != 0)
+        {
+            fprintf(stderr, "axcl_Memcpy D2H failed. grpid=%d idx=%zu size=%d ret=0x%x\n",
+                    grpid, i, outputs[i].nSize, r);
+            return r;
+        }
+    }
+    return 0;
+}
+
 int ax_runner_axcl::inference(int grpid)
+{
+    return inference(grpid, 0);
+}
+
+int ax_runner_axcl::inference(int grpid, int io_slot)
 {
     if (_auto_sync_before_inference)
-        for (size_t i = 0; i < mgroup_input_tensors[grpid].size(); i++)
+    {
+        auto r = sync_inputs(grpid, io_slot);
+        if (r != 0)
         {
-            auto r = axcl_Memcpy((void *)mgroup_input_tensors[grpid][i].phyAddr,
-                                 mgroup_input_tensors[grpid][i].pVirAddr,
-                                 mgroup_input_tensors[grpid][i].nSize,
-                                 AXCL_MEMCPY_HOST_TO_DEVICE,
-                                 _devid);
-            if (r != 0)
-            {
-                fprintf(stderr, "axcl_Memcpy H2D failed. grpid=%d idx=%zu size=%d ret=0x%x\n",
-                        grpid, i, mgroup_input_tensors[grpid][i].nSize, r);
-                return r;
-            }
+            return r;
         }
+    }
 
-    auto ret = axcl_EngineExecute(m_handle->handle, m_handle->context, grpid, m_handle->ios[grpid], _devid);
+    auto ret = axcl_EngineExecute(m_handle->handle, m_handle->contexts[io_slot], grpid, m_handle->ios[io_slot][grpid], _devid);
     if (ret != 0)
     {
         fprintf(stderr, "axclrtEngineExecute failed. ret=0x%x\n", ret);
         return ret;
     }
     if (_auto_sync_after_inference)
-        for (size_t i = 0; i < mgroup_output_tensors[grpid].size(); i++)
+    {
+        return sync_outputs(grpid, io_slot);
+    }
+    return 0;
+}
+
+// H2D copies of the slot's inputs queued on its stream, so the upload overlaps whatever the NPU is running
+int ax_runner_axcl::queue_inputs(int grpid, int io_slot)
+{
+    auto &inputs = mslot_group_input_tensors[io_slot][grpid];
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        auto r = axcl_MemcpyAsync((void *)inputs[i].phyAddr,
+                                  inputs[i].pVirAddr,
+                                  valid_bytes(inputs[i], io_slot, grpid),
+                                  AXCL_MEMCPY_HOST_TO_DEVICE,
+                                  m_handle->streams[io_slot],
+                                  _devid);
+        if (r != 0)
+        {
+            return r;
+        }
+    }
+    return 0;
+}
+
+int ax_runner_axcl::queue_outputs(int grpid, int io_slot)
+{
+    auto &outputs = mslot_group_output_tensors[io_slot][grpid];
+    for (size_t i = 0; i < outputs.size(); i++)
+    {
+        auto r = axcl_MemcpyAsync(outputs[i].pVirAddr,
+                                  (void *)outputs[i].phyAddr,
+                                  valid_bytes(outputs[i], io_slot, grpid),
+                                  AXCL_MEMCPY_DEVICE_TO_HOST,
+                                  m_handle->streams[io_slot],
+                                  _devid);
+        if (r != 0)
         {
-            auto r = axcl_Memcpy(mgroup_output_tensors[grpid][i].pVirAddr,
-                                 (void *)mgroup_output_tensors[grpid][i].phyAddr,
-                                 mgroup_output_tensors[grpid][i].nSize,
-                                 AXCL_MEMCPY_DEVICE_TO_HOST,
-                                 _devid);
-            if (r != 0)
+            return r;
+        }
+    }
+    return 0;
+}
+
+int ax_runner_axcl::submit(int grpid, int io_slot)
+{
+    if (!m_handle || io_slot < 0 || io_slot >= get_num_io_slots() || grpid < 0 || grpid >= group_count)
+    {
+        return -1;
+    }
+    auto &stream = m_handle->streams[io_slot];
+    if (!stream)
+    {
+        auto ret = axcl_CreateStream(&stream, _devid);
+        if (ret != 0)
+        {
+            // runtimes without stream support still get overlap from the helper thread
+            ALOGW("axclrtCreateStream failed, ret=0x%x, falling back to blocking execute", ret);
+            stream = nullptr;
+            return ax_runner_base::submit(grpid, io_slot);
+        }
+    }
+
+    // H2D -> execute -> D2H all go on the slot's stream; with two or more slots the upload of one
+    // run overlaps the execute of the previous one and the download of the one before that
+    if (_auto_sync_before_inference)
+    {
+        bool queued = false;
+        if (m_async_copy)
+        {
+            queued = queue_inputs(grpid, io_slot) == 0;
+            if (!queued)
             {
-                fprintf(stderr, "axcl_Memcpy D2H failed. grpid=%d idx=%zu size=%d ret=0x%x\n",
-                        grpid, i, mgroup_output_tensors[grpid][i].nSize, r);
-                return r;
+                // inputs queued before the failure are harmlessly copied again below
+                ALOGW("axclrtMemcpyAsync unavailable, using blocking copies");
+                m_async_copy = false;
             }
         }
+        if (!queued && sync_inputs(grpid, io_slot) != 0)
+        {
+            return -1;
+        }
+    }
+
+    auto ret = axcl_EngineExecuteAsync(m_handle->handle, m_handle->contexts[io_slot], grpid, m_handle->ios[io_slot][grpid], stream, _devid);
+    if (ret != 0)
+    {
+        fprintf(stderr, "axclrtEngineExecuteAsync failed. ret=0x%x\n", ret);
+        return -1;
+    }
+
+    bool outputs_queued = _auto_sync_after_inference && m_async_copy && queue_outputs(grpid, io_slot) == 0;
+
+    std::lock_guard<std::mutex> lock(m_ticket_mutex);
+    int ticket = m_next_ticket++;
+    m_stream_tickets[ticket] = {io_slot, grpid, outputs_queued};
+    return ticket;
+}
+
+int ax_runner_axcl::wait(int ticket)
+{
+    stream_ticket_t st = {-1, -1, false};
+    {
+        std::lock_guard<std::mutex> lock(m_ticket_mutex);
+        auto it = m_stream_tickets.find(ticket);
+        if (it != m_stream_tickets.end())
+        {
+            st = it->second;
+            m_stream_tickets.erase(it);
+        }
+    }
+    if (st.io_slot < 0)
+    {
+        return ax_runner_base::wait(ticket);
+    }
+
+    // each slot has its own stream running in submission order, so this also retires the slot's earlier tickets
+    auto ret = axcl_SynchronizeStream(m_handle->streams[st.io_slot], _devid);
+    if (ret != 0)
+    {
+        fprintf(stderr, "axclrtSynchronizeStream failed. ret=0x%x\n", ret);
+        return ret;
+    }
+    if (_auto_sync_after_inference && !st.outputs_queued)
+    {
+        return sync_outputs(st.grpid, st.io_slot);
+    }
     return 0;
 }
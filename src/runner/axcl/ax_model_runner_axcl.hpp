@@ -2,6 +2,7 @@
 #include "../ax_model_runner.hpp"
 
 #include <map>
+#include <atomic>
 
 class ax_runner_axcl : public ax_runner_base
 {
@@ -11,7 +12,22 @@ protected:
     bool _auto_sync_before_inference = true;
     bool _auto_sync_after_inference = true;
 
+    struct stream_ticket_t
+    {
+        int io_slot;
+        int grpid;
+        bool outputs_queued; // D2H copies were queued on the stream behind the execute
+    };
+    // tickets queued on a slot stream and not waited yet, guarded by m_ticket_mutex
+    std::map<int, stream_ticket_t> m_stream_tickets;
+    // cleared once the runtime turns out not to support axclrtMemcpyAsync
+    std::atomic<bool> m_async_copy{true};
+
     int sub_init();
+    int sync_inputs(int grpid, int io_slot);
+    int sync_outputs(int grpid, int io_slot);
+    int queue_inputs(int grpid, int io_slot);
+    int queue_outputs(int grpid, int io_slot);
 
 public:
     int init(const void *model_data, unsigned int model_size, int devid) override;
@@ -27,5 +43,10 @@ public:
     int set_output(int grpid, std::string name, unsigned long long int phy_addr, unsigned long size);
 
     int inference() override;
-    int inference(int grpid);
+    int inference(int grpid) override;
+    int inference(int grpid, int io_slot) override;
+
+    using ax_runner_base::submit;
+    int submit(int grpid, int io_slot = 0) override;
+    int wait(int ticket) override;
 };
\ No newline at end of file
@@ -91,6 +91,11 @@ axclError axcl_Finalize()
 }
 
 axclError axcl_Dev_Init(int devid)
+{
+    return axcl_Dev_Init_VNpu(devid, AXCL_VNPU_DISABLE);
+}
+
+axclError axcl_Dev_Init_VNpu(int devid, int vnpu_mode)
 {
     std::lock_guard<std::mutex> lock(g_devices_mu);
     if (axcl_contains(devid))
@@ -99,7 +104,7 @@ axclError axcl_Dev_Init(int devid)
         return 0;
     }
     g_devices[devid] = std::make_shared<AXCLWorker>();
-    if (!g_devices[devid]->Run(devid))
+    if (!g_devices[devid]->Run(devid, vnpu_mode))
     {
         return -1;
     }
@@ -215,6 +220,38 @@ axclError axcl_Memcmp(const void *devPtr1, const void *devPtr2, size_t count, in
     }
     return g_devices[devid]->axclMemcmp(devPtr1, devPtr2, count);
 }
+axclError axcl_CreateStream(axclrtStream *stream, int devid)
+{
+    if (!axcl_contains(devid))
+    {
+        ALOGE("AXCL device %d not inited\n", devid);
+    }
+    return g_devices[devid]->axclCreateStream(stream);
+}
+axclError axcl_DestroyStream(axclrtStream stream, int devid)
+{
+    if (!axcl_contains(devid))
+    {
+        ALOGE("AXCL device %d not inited\n", devid);
+    }
+    return g_devices[devid]->axclDestroyStream(stream);
+}
+axclError axcl_SynchronizeStream(axclrtStream stream, int devid)
+{
+    if (!axcl_contains(devid))
+    {
+        ALOGE("AXCL device %d not inited\n", devid);
+    }
+    return g_devices[devid]->axclSynchronizeStream(stream);
+}
+axclError axcl_MemcpyAsync(void *dstPtr, const void *srcPtr, size_t count, axclrtMemcpyKind kind, axclrtStream stream, int devid)
+{
+    if (!axcl_contains(devid))
+    {
+        ALOGE("AXCL device %d not inited\n", devid);
+    }
+    return g_devices[devid]->axclMemcpyAsync(dstPtr, srcPtr, count, kind, stream);
+}
 
 axclError axcl_EngineLoadFromFile(const char *modelPath, uint64_t *modelId, int devid)
 {
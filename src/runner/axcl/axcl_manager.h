@@ -10,6 +10,7 @@ extern "C"
     axclError axcl_Finalize();
 
     axclError axcl_Dev_Init(int devid);
+    axclError axcl_Dev_Init_VNpu(int devid, int vnpu_mode);
     bool axcl_Dev_IsInit(int devid);
     axclError axcl_Dev_Exit(int devid);
 
@@ -26,6 +27,11 @@ extern "C"
     axclError axcl_Memcpy(void *dstPtr, const void *srcPtr, size_t count, axclrtMemcpyKind kind, int devid);
     axclError axcl_Memcmp(const void *devPtr1, const void *devPtr2, size_t count, int devid);
 
+    axclError axcl_CreateStream(axclrtStream *stream, int devid);
+    axclError axcl_DestroyStream(axclrtStream stream, int devid);
+    axclError axcl_SynchronizeStream(axclrtStream stream, int devid);
+    axclError axcl_MemcpyAsync(void *dstPtr, const void *srcPtr, size_t count, axclrtMemcpyKind kind, axclrtStream stream, int devid);
+
     axclError axcl_EngineLoadFromFile(const char *modelPath, uint64_t *modelId, int devid);
     axclError axcl_EngineLoadFromMem(const void *model, uint64_t modelSize, uint64_t *modelId, int devid);
     axclError axcl_EngineUnload(uint64_t modelId, int devid);
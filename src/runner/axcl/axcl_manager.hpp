@@ -27,6 +27,7 @@ private:
     std::atomic<bool> stop_flag;
     bool direct_mode;
     int current_device_id;
+    int vnpu_mode = AXCL_VNPU_DISABLE;
 
     std::promise<bool> initPromise;
 
@@ -51,9 +52,9 @@ private:
             current_device_id = -1;
             return false;
         }
-        if (const auto ret = getLoader().axclrtEngineInit(AXCL_VNPU_DISABLE); 0 != ret)
+        if (const auto ret = getLoader().axclrtEngineInit((axclrtEngineVNpuKind)vnpu_mode); 0 != ret)
         {
-            ALOGE("getLoader().axclrtEngineInit %d", ret);
+            ALOGE("getLoader().axclrtEngineInit %d, vnpu mode %d", ret, vnpu_mode);
             if (getLoader().axclrtResetDevice)
             {
                 getLoader().axclrtResetDevice(current_device_id);
@@ -185,6 +186,31 @@ private:
     {
         return getLoader().axclrtMemcmp(devPtr1, devPtr2, count);
     }
+    // stream APIs are missing from older runtimes, callers fall back to the blocking calls
+    axclError axclrtCreateStream_func(axclrtStream *stream)
+    {
+        if (!getLoader().axclrtCreateStream)
+            return -1;
+        return getLoader().axclrtCreateStream(stream);
+    }
+    axclError axclrtDestroyStream_func(axclrtStream stream)
+    {
+        if (!getLoader().axclrtDestroyStream)
+            return -1;
+        return getLoader().axclrtDestroyStream(stream);
+    }
+    axclError axclrtSynchronizeStream_func(axclrtStream stream)
+    {
+        if (!getLoader().axclrtSynchronizeStream)
+            return -1;
+        return getLoader().axclrtSynchronizeStream(stream);
+    }
+    axclError axclrtMemcpyAsync_func(void *dstPtr, const void *srcPtr, size_t count, axclrtMemcpyKind kind, axclrtStream stream)
+    {
+        if (!getLoader().axclrtMemcpyAsync)
+            return -1;
+        return getLoader().axclrtMemcpyAsync(dstPtr, srcPtr, count, kind, stream);
+    }
 
     // ────────── 以下为各 API 的内部实现（私有部分，后缀 _func） ──────────
     // 1. axclrtEngineLoadFromFile
@@ -392,9 +418,10 @@ public:
         Stop();
     }
 
-    bool Run(int devid)
+    bool Run(int devid, int vnpu = AXCL_VNPU_DISABLE)
     {
         stop_flag = false;
+        vnpu_mode = vnpu;
 #if defined(_WIN32) || defined(_WIN64)
         direct_mode = true;
         return initialize_device_context(devid);
@@ -491,6 +518,26 @@ public:
         auto future_result = addTaskWithResult(&AXCLWorker::axclrtMemcmp_func, this, devPtr1, devPtr2, count);
         return future_result.get();
     }
+    axclError axclCreateStream(axclrtStream *stream)
+    {
+        auto future_result = addTaskWithResult(&AXCLWorker::axclrtCreateStream_func, this, stream);
+        return future_result.get();
+    }
+    axclError axclDestroyStream(axclrtStream stream)
+    {
+        auto future_result = addTaskWithResult(&AXCLWorker::axclrtDestroyStream_func, this, stream);
+        return future_result.get();
+    }
+    axclError axclSynchronizeStream(axclrtStream stream)
+    {
+        auto future_result = addTaskWithResult(&AXCLWorker::axclrtSynchronizeStream_func, this, stream);
+        return future_result.get();
+    }
+    axclError axclMemcpyAsync(void *dstPtr, const void *srcPtr, size_t count, axclrtMemcpyKind kind, axclrtStream stream)
+    {
+        auto future_result = addTaskWithResult(&AXCLWorker::axclrtMemcpyAsync_func, this, dstPtr, srcPtr, count, kind, stream);
+        return future_result.get();
+    }
 
     // ────────── 以下为对外的 API 封装，顺序按照需求排列 ──────────
     axclError axclEngineLoadFromFile(const char *modelPath, uint64_t *modelId)
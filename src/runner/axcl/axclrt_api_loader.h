@@ -108,6 +108,11 @@ public:
     axclError (*axclrtMemcpy)(void *dstPtr, const void *srcPtr, size_t count, axclrtMemcpyKind kind) = nullptr;
     axclError (*axclrtMemcmp)(const void *devPtr1, const void *devPtr2, size_t count) = nullptr;
 
+    axclError (*axclrtCreateStream)(axclrtStream *stream) = nullptr;
+    axclError (*axclrtDestroyStream)(axclrtStream stream) = nullptr;
+    axclError (*axclrtSynchronizeStream)(axclrtStream stream) = nullptr;
+    axclError (*axclrtMemcpyAsync)(void *dstPtr, const void *srcPtr, size_t count, axclrtMemcpyKind kind, axclrtStream stream) = nullptr;
+
     axclError (*axclrtEngineInit)(axclrtEngineVNpuKind npuKind) = nullptr;
     axclError (*axclrtEngineGetVNpuKind)(axclrtEngineVNpuKind *npuKind) = nullptr;
     axclError (*axclrtEngineFinalize)() = nullptr;
@@ -277,6 +282,10 @@ private:
         axclrtMemset = &::axclrtMemset;
         axclrtMemcpy = &::axclrtMemcpy;
         axclrtMemcmp = &::axclrtMemcmp;
+        axclrtCreateStream = &::axclrtCreateStream;
+        axclrtDestroyStream = &::axclrtDestroyStream;
+        axclrtSynchronizeStream = &::axclrtSynchronizeStream;
+        axclrtMemcpyAsync = &::axclrtMemcpyAsync;
         axclrtEngineInit = &::axclrtEngineInit;
         axclrtEngineGetVNpuKind = &::axclrtEngineGetVNpuKind;
         axclrtEngineFinalize = &::axclrtEngineFinalize;
@@ -350,6 +359,11 @@ private:
         load_symbol(axclrtMemcpy, "axclrtMemcpy");
         load_symbol(axclrtMemcmp, "axclrtMemcmp");
 
+        load_symbol(axclrtCreateStream, "axclrtCreateStream");
+        load_symbol(axclrtDestroyStream, "axclrtDestroyStream");
+        load_symbol(axclrtSynchronizeStream, "axclrtSynchronizeStream");
+        load_symbol(axclrtMemcpyAsync, "axclrtMemcpyAsync");
+
         load_symbol(axclrtEngineInit, "axclrtEngineInit");
         load_symbol(axclrtEngineGetVNpuKind, "axclrtEngineGetVNpuKind");
         load_symbol(axclrtEngineFinalize, "axclrtEngineFinalize");
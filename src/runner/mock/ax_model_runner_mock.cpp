@@ -0,0 +1,366 @@
+#include "ax_model_runner_mock.hpp"
+#include "utils/sample_log.h"
+
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <thread>
+
+void print_io_info(std::vector<ax_runner_tensor_t> &input, std::vector<ax_runner_tensor_t> &output);
+
+// buckets of the input sketch, the projection maps them to each output row
+#define MOCK_SKETCH_SIZE 256
+
+static inline uint32_t mock_hash(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352d;
+    x ^= x >> 15;
+    x *= 0x846ca68b;
+    x ^= x >> 16;
+    return x;
+}
+
+// signed count sketch of one input row, element i of input t always lands in the same bucket
+template <typename T>
+static void sketch_row(const T *data, int count, uint32_t key, float *sketch)
+{
+    for (int i = 0; i < count; i++)
+    {
+        uint32_t h = mock_hash(key ^ (uint32_t)i * 0x9e3779b9u);
+        float v = (float)data[i];
+        sketch[h % MOCK_SKETCH_SIZE] += (h & 0x80000000u) ? -v : v;
+    }
+}
+
+static int mock_dtype_size(int dtype)
+{
+    return dtype == 0 ? 1 : 4;
+}
+
+std::string ax_runner_mock::spec_path(const std::string &model_path)
+{
+    std::ifstream fs(model_path + ".mock");
+    return fs.good() ? model_path + ".mock" : model_path;
+}
+
+int ax_runner_mock::parse_spec(const std::string &spec, std::vector<std::vector<ax_runner_tensor_t>> &inputs,
+                               std::vector<std::vector<ax_runner_tensor_t>> &outputs)
+{
+    std::istringstream ss(spec);
+    std::string line;
+    int line_no = 0;
+    while (std::getline(ss, line))
+    {
+        line_no++;
+        auto comment = line.find('#');
+        if (comment != std::string::npos)
+        {
+            line.erase(comment);
+        }
+        std::istringstream ls(line);
+        std::string key;
+        if (!(ls >> key))
+        {
+            continue;
+        }
+
+        if (key == "seed")
+        {
+            ls >> m_seed;
+        }
+        else if (key == "latency_us")
+        {
+            ls >> m_latency_us;
+        }
+        else if (key == "batch_latency_us")
+        {
+            ls >> m_batch_latency_us;
+        }
+        else if (key == "group")
+        {
+            inputs.emplace_back();
+            outputs.emplace_back();
+            m_input_dtypes.emplace_back();
+        }
+        else if (key == "input" || key == "output")
+        {
+            if (inputs.empty())
+            {
+                inputs.emplace_back();
+                outputs.emplace_back();
+                m_input_dtypes.emplace_back();
+            }
+            ax_runner_tensor_t tensor;
+            ls >> tensor.sName;
+            std::vector<std::string> fields;
+            std::string field;
+            while (ls >> field)
+            {
+                fields.push_back(field);
+            }
+            if (tensor.sName.empty() || fields.size() < 2)
+            {
+                ALOGE("mock spec line %d: expected \"%s <name> <dims...> <type>\"", line_no, key.c_str());
+                return -1;
+            }
+
+            mock_dtype_e dtype;
+            if (fields.back() == "u8")
+            {
+                dtype = mock_u8;
+            }
+            else if (fields.back() == "i32")
+            {
+                dtype = mock_i32;
+            }
+            else if (fields.back() == "f32")
+            {
+                dtype = mock_f32;
+            }
+            else
+            {
+                ALOGE("mock spec line %d: unknown type %s", line_no, fields.back().c_str());
+                return -1;
+            }
+            if (key == "output" && dtype != mock_f32)
+            {
+                ALOGE("mock spec line %d: outputs must be f32", line_no);
+                return -1;
+            }
+
+            tensor.nSize = mock_dtype_size(dtype);
+            for (size_t i = 0; i + 1 < fields.size(); i++)
+            {
+                int dim = atoi(fields[i].c_str());
+                if (dim <= 0)
+                {
+                    ALOGE("mock spec line %d: bad dim %s", line_no, fields[i].c_str());
+                    return -1;
+                }
+                tensor.vShape.push_back(dim);
+                tensor.nSize *= dim;
+            }
+            tensor.phyAddr = 0;
+            tensor.pVirAddr = nullptr;
+            if (key == "input")
+            {
+                tensor.nIdx = inputs.back().size();
+                inputs.back().push_back(tensor);
+                m_input_dtypes.back().push_back(dtype);
+            }
+            else
+            {
+                tensor.nIdx = outputs.back().size();
+                outputs.back().push_back(tensor);
+            }
+        }
+        else
+        {
+            ALOGE("mock spec line %d: unknown key %s", line_no, key.c_str());
+            return -1;
+        }
+    }
+
+    if (inputs.empty())
+    {
+        ALOGE("mock spec has no tensors");
+        return -1;
+    }
+    for (size_t grpid = 0; grpid < inputs.size(); grpid++)
+    {
+        if (inputs[grpid].empty() || outputs[grpid].empty())
+        {
+            ALOGE("mock spec group %d needs at least one input and one output", (int)grpid);
+            return -1;
+        }
+        // rows are sketched and projected one by one, so every tensor of a group has the same batch dim
+        for (auto &tensor : outputs[grpid])
+        {
+            if (tensor.vShape[0] != inputs[grpid][0].vShape[0])
+            {
+                ALOGE("mock spec group %d: output %s batch %d != input batch %d", (int)grpid, tensor.sName.c_str(),
+                      tensor.vShape[0], inputs[grpid][0].vShape[0]);
+                return -1;
+            }
+        }
+        for (auto &tensor : inputs[grpid])
+        {
+            if (tensor.vShape[0] != inputs[grpid][0].vShape[0])
+            {
+                ALOGE("mock spec group %d: input %s batch %d != input batch %d", (int)grpid, tensor.sName.c_str(),
+                      tensor.vShape[0], inputs[grpid][0].vShape[0]);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int ax_runner_mock::init(const void *model_data, unsigned int model_size, int devid)
+{
+    if (m_inited)
+    {
+        return -1;
+    }
+    if (model_data == nullptr || model_size == 0)
+    {
+        ALOGE("mock spec is empty");
+        return -1;
+    }
+    _devid = devid;
+
+    std::vector<std::vector<ax_runner_tensor_t>> inputs, outputs;
+    m_input_dtypes.clear();
+    int ret = parse_spec(std::string((const char *)model_data, model_size), inputs, outputs);
+    if (ret != 0)
+    {
+        m_input_dtypes.clear();
+        return ret;
+    }
+
+    // every io slot gets its own zeroed host buffers, like the contexts of a real runner
+    mslot_group_input_tensors.assign(m_num_io_slots, inputs);
+    mslot_group_output_tensors.assign(m_num_io_slots, outputs);
+    for (int slot = 0; slot < m_num_io_slots; slot++)
+    {
+        for (size_t grpid = 0; grpid < inputs.size(); grpid++)
+        {
+            for (auto *tensors : {&mslot_group_input_tensors[slot][grpid], &mslot_group_output_tensors[slot][grpid]})
+            {
+                for (auto &tensor : *tensors)
+                {
+                    m_buffers.emplace_back(new uint8_t[tensor.nSize]());
+                    tensor.pVirAddr = m_buffers.back().get();
+                }
+            }
+            if (slot == 0)
+            {
+                print_io_info(mslot_group_input_tensors[slot][grpid], mslot_group_output_tensors[slot][grpid]);
+            }
+        }
+    }
+
+    // one fixed projection per output row length, drawn from mt19937 so it is the same on every platform
+    std::mt19937 rng(m_seed);
+    for (auto &group : outputs)
+    {
+        for (auto &tensor : group)
+        {
+            int dim = tensor.nSize / sizeof(float) / tensor.vShape[0];
+            if (m_projections.count(dim))
+            {
+                continue;
+            }
+            auto &proj = m_projections[dim];
+            proj.resize((size_t)dim * MOCK_SKETCH_SIZE);
+            for (auto &v : proj)
+            {
+                v = (float)rng() / 4294967295.0f * 2.0f - 1.0f;
+            }
+        }
+    }
+
+    mgroup_input_tensors = mslot_group_input_tensors[0];
+    mgroup_output_tensors = mslot_group_output_tensors[0];
+    moutput_tensors = mgroup_output_tensors[0];
+    minput_tensors = mgroup_input_tensors[0];
+    reset_slot_pool();
+    m_inited = true;
+
+    ALOGI("mock model: %d groups, %d io slots, seed %u, latency %d us + %d us per batch entry", (int)inputs.size(),
+          m_num_io_slots, m_seed, m_latency_us, m_batch_latency_us);
+    return 0;
+}
+
+void ax_runner_mock::deinit()
+{
+    drain();
+    m_inited = false;
+    mslot_group_input_tensors.clear();
+    mslot_group_output_tensors.clear();
+    reset_slot_pool();
+    m_buffers.clear();
+    m_projections.clear();
+    m_input_dtypes.clear();
+}
+
+int ax_runner_mock::inference()
+{
+    return inference(0, 0);
+}
+
+int ax_runner_mock::inference(int grpid)
+{
+    return inference(grpid, 0);
+}
+
+int ax_runner_mock::inference(int grpid, int io_slot)
+{
+    if (!m_inited || io_slot < 0 || io_slot >= (int)mslot_group_input_tensors.size() ||
+        grpid < 0 || grpid >= (int)mslot_group_input_tensors[io_slot].size())
+    {
+        return -1;
+    }
+    auto start = std::chrono::steady_clock::now();
+
+    auto &inputs = mslot_group_input_tensors[io_slot][grpid];
+    auto &outputs = mslot_group_output_tensors[io_slot][grpid];
+    int rows = inputs[0].vShape[0];
+    int valid = m_valid_batch[io_slot][grpid];
+    if (valid <= 0 || valid > rows)
+    {
+        valid = rows;
+    }
+
+    std::vector<float> sketch(MOCK_SKETCH_SIZE);
+    for (int b = 0; b < valid; b++)
+    {
+        std::fill(sketch.begin(), sketch.end(), 0.0f);
+        for (size_t t = 0; t < inputs.size(); t++)
+        {
+            auto &tensor = inputs[t];
+            auto dtype = m_input_dtypes[grpid][t];
+            int row_bytes = tensor.nSize / rows;
+            int count = row_bytes / mock_dtype_size(dtype);
+            const uint8_t *row = (const uint8_t *)tensor.pVirAddr + (size_t)b * row_bytes;
+            uint32_t key = m_seed + (uint32_t)t * 0x85ebca6bu;
+            if (dtype == mock_u8)
+            {
+                sketch_row(row, count, key, sketch.data());
+            }
+            else if (dtype == mock_i32)
+            {
+                sketch_row((const int32_t *)row, count, key, sketch.data());
+            }
+            else
+            {
+                sketch_row((const float *)row, count, key, sketch.data());
+            }
+        }
+
+        for (auto &tensor : outputs)
+        {
+            int dim = tensor.nSize / sizeof(float) / rows;
+            const float *proj = m_projections.at(dim).data();
+            float *out = (float *)tensor.pVirAddr + (size_t)b * dim;
+            for (int j = 0; j < dim; j++)
+            {
+                float sum = 0.0f;
+                for (int k = 0; k < MOCK_SKETCH_SIZE; k++)
+                {
+                    sum += sketch[k] * proj[(size_t)j * MOCK_SKETCH_SIZE + k];
+                }
+                out[j] = sum;
+            }
+        }
+    }
+
+    // the simulated latency includes the time spent computing the outputs
+    int latency_us = m_latency_us + m_batch_latency_us * valid;
+    if (latency_us > 0)
+    {
+        std::this_thread::sleep_until(start + std::chrono::microseconds(latency_us));
+    }
+    return 0;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "../ax_model_runner.hpp"
+
+#include <memory>
+
+// CPU stand-in for an NPU model, selected with mock_device. Instead of an axmodel it loads a small text
+// spec with the io shapes of each shape group:
+//
+//     seed 42                  # projection seed (default 0)
+//     latency_us 8000          # simulated time per inference (default 0)
+//     batch_latency_us 2000    # added per filled batch entry (default 0)
+//     group                    # starts the next shape group
+//     input image 1 224 224 3 u8
+//     output image_features 1 512 f32
+//
+// Input types are u8, i32 or f32, outputs are f32. Every output row is a fixed random projection of a
+// sketch of the matching input rows, so the same input gives the same embedding on any host and batch size.
+class ax_runner_mock : public ax_runner_base
+{
+protected:
+    enum mock_dtype_e
+    {
+        mock_u8,
+        mock_i32,
+        mock_f32,
+    };
+
+    uint32_t m_seed = 0;
+    int m_latency_us = 0;
+    int m_batch_latency_us = 0;
+    bool m_inited = false;
+
+    // element type per [grpid][input idx]
+    std::vector<std::vector<mock_dtype_e>> m_input_dtypes;
+    // projection matrix per output row length, [dim][sketch bucket]
+    std::map<int, std::vector<float>> m_projections;
+    std::vector<std::unique_ptr<uint8_t[]>> m_buffers;
+
+    int parse_spec(const std::string &spec, std::vector<std::vector<ax_runner_tensor_t>> &inputs,
+                   std::vector<std::vector<ax_runner_tensor_t>> &outputs);
+
+public:
+    // the spec of a mock model is "<model path>.mock" when that file exists, otherwise the model path itself
+    static std::string spec_path(const std::string &model_path);
+
+    int init(const void *model_data, unsigned int model_size, int devid) override;
+
+    void deinit() override;
+
+    // no cores to pin, accepted so affinity settings work unchanged
+    int set_affinity(int id) override { return 0; }
+
+    int inference() override;
+    int inference(int grpid) override;
+    int inference(int grpid, int io_slot) override;
+};
@@ -169,10 +169,14 @@ std::vector<int> Tokenizer::encode(const std::string& str) {
     std::vector<int> ids = prefix_tokens_;
     // Heuristic reserve to reduce re-allocations on long inputs.
     ids.reserve(ids.size() + str.size() / 2);
+    encode_append(str, ids);
+    return ids;
+}
 
+void Tokenizer::encode_append(const std::string& str, std::vector<int>& ids) {
     if (special_tokens_.empty()) {
         encode(str, ids);
-        return ids;
+        return;
     }
 
     ensure_special_cache();
@@ -201,9 +205,8 @@ std::vector<int> Tokenizer::encode(const std::string& str) {
         }
     }
     if (start < text.size()) {
-        encode(text.substr(start), ids);
+        encode(start == 0 ? text : text.substr(start), ids);
     }
-    return ids;
 }
 
 void Tokenizer::ensure_special_cache() const {
@@ -433,6 +436,10 @@ void Sentencepiece::encode(const std::string& str, std::vector<int>& ids) {
     }
 }
 
+int Sentencepiece::vocab_size() const {
+    return (int)sentence_pieces_.size();
+}
+
 std::string Sentencepiece::decode(int id) const {
     auto piece = sentence_pieces_[id].piece;
     int pos = piece.find("▁");
@@ -547,6 +554,10 @@ void Tiktoken::encode(const std::string& str, std::vector<int>& ids) {
     }
 }
 
+int Tiktoken::vocab_size() const {
+    return (int)decoder_.size();
+}
+
 std::string Tiktoken::decode(int id) const {
     if (id >= decoder_.size()) {
         return "";
@@ -811,6 +822,10 @@ void HuggingfaceTokenizer::encode(const std::string& str, std::vector<int>& ids)
     }
 }
 
+int HuggingfaceTokenizer::vocab_size() const {
+    return (int)decoder_.size();
+}
+
 std::string HuggingfaceTokenizer::decode(int id) const {
     // printf("decode id = %d, %lu, %s#\n", id, decoder_.size(), decoder_.at(id).c_str());
     if (id >= decoder_.size()) {
@@ -74,7 +74,12 @@ public:
     bool is_special(int token);
     std::vector<int> get_stop_tokens();
     std::vector<int> encode(const std::string& str);
+    // Same as encode() without the prefix tokens, appending to ids so callers can reuse the buffer.
+    void encode_append(const std::string& str, std::vector<int>& ids);
+    const std::vector<int>& get_prefix_tokens() const { return prefix_tokens_; }
     virtual std::string decode(int id) const = 0;
+    // Number of ids in the vocab, valid token ids are [0, vocab_size()).
+    virtual int vocab_size() const = 0;
 protected:
     virtual void load_special(std::ifstream& file);
     virtual bool load_vocab(std::ifstream& file) = 0;
@@ -92,6 +97,7 @@ class Sentencepiece : public Tokenizer {
 public:
     Sentencepiece() = default;
     virtual std::string decode(int id) const override;
+    virtual int vocab_size() const override;
 protected:
     virtual bool load_vocab(std::ifstream& file) override;
     virtual void encode(const std::string& str, std::vector<int>& ids) override;
@@ -144,6 +150,7 @@ class Tiktoken : public Tokenizer {
 public:
     Tiktoken() = default;
     virtual std::string decode(int id) const override;
+    virtual int vocab_size() const override;
 protected:
     virtual bool load_vocab(std::ifstream& file) override;
     virtual void encode(const std::string& str, std::vector<int>& ids) override;
@@ -189,6 +196,7 @@ using BPERanks = std::unordered_map<std::pair<std::wstring, std::wstring>, int,
 public:
     HuggingfaceTokenizer() = default;
     virtual std::string decode(int id) const override;
+    virtual int vocab_size() const override;
 protected:
     virtual bool load_vocab(std::ifstream& file) override;
     virtual void encode(const std::string& str, std::vector<int>& ids) override;
@@ -0,0 +1,78 @@
+#pragma once
+#include <queue>
+#include <mutex>
+#include <condition_variable>
+
+// Blocking FIFO with a fixed capacity; push() waits while full, pop() waits while empty.
+// close() wakes everybody up, after which pop() drains what is left and then returns false.
+template <typename T>
+class BoundedQueue
+{
+private:
+    std::queue<T> m_queue;
+    std::mutex m_mutex;
+    std::condition_variable m_not_full;
+    std::condition_variable m_not_empty;
+    size_t m_capacity;
+    bool m_closed = false;
+
+public:
+    explicit BoundedQueue(size_t capacity) : m_capacity(capacity > 0 ? capacity : 1) {}
+
+    bool push(T item)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_not_full.wait(lock, [this]
+                        { return m_closed || m_queue.size() < m_capacity; });
+        if (m_closed)
+        {
+            return false;
+        }
+        m_queue.push(std::move(item));
+        m_not_empty.notify_one();
+        return true;
+    }
+
+    bool pop(T &item)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_not_empty.wait(lock, [this]
+                         { return m_closed || !m_queue.empty(); });
+        if (m_queue.empty())
+        {
+            return false;
+        }
+        item = std::move(m_queue.front());
+        m_queue.pop();
+        m_not_full.notify_one();
+        return true;
+    }
+
+    // non-blocking pop, used to top up a batch with whatever is already decoded
+    bool try_pop(T &item)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_queue.empty())
+        {
+            return false;
+        }
+        item = std::move(m_queue.front());
+        m_queue.pop();
+        m_not_full.notify_one();
+        return true;
+    }
+
+    size_t size()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_queue.size();
+    }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+        m_not_full.notify_all();
+        m_not_empty.notify_all();
+    }
+};
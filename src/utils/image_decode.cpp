@@ -0,0 +1,138 @@
+#include "image_decode.hpp"
+#include "sample_log.h"
+
+#include <cstdio>
+#include <csetjmp>
+
+#ifdef CLIP_WITH_LIBJPEG
+#include <jpeglib.h>
+#endif
+
+int select_dct_scale_denom(int width, int height, int target_width, int target_height)
+{
+    if (target_width <= 0 || target_height <= 0)
+    {
+        return 1;
+    }
+    for (int denom = 8; denom > 1; denom /= 2)
+    {
+        // libjpeg rounds the scaled size up
+        int scaled_w = (width + denom - 1) / denom;
+        int scaled_h = (height + denom - 1) / denom;
+        if (scaled_w >= target_width && scaled_h >= target_height)
+        {
+            return denom;
+        }
+    }
+    return 1;
+}
+
+#ifdef CLIP_WITH_LIBJPEG
+struct jpeg_error_jmp_t
+{
+    jpeg_error_mgr pub;
+    jmp_buf setjmp_buffer;
+};
+
+static void jpeg_error_exit_jmp(j_common_ptr cinfo)
+{
+    jpeg_error_jmp_t *err = (jpeg_error_jmp_t *)cinfo->err;
+    char msg[JMSG_LENGTH_MAX];
+    (*cinfo->err->format_message)(cinfo, msg);
+    ALOGW("libjpeg: %s", msg);
+    longjmp(err->setjmp_buffer, 1);
+}
+
+static bool is_jpeg(FILE *fp)
+{
+    unsigned char magic[3] = {0};
+    size_t n = fread(magic, 1, 3, fp);
+    rewind(fp);
+    return n == 3 && magic[0] == 0xFF && magic[1] == 0xD8 && magic[2] == 0xFF;
+}
+
+// setjmp/longjmp must not skip C++ destructors, so the two stages that may raise a libjpeg error
+// live in their own frames that hold only plain data
+static bool jpeg_begin_scaled(jpeg_decompress_struct *cinfo, jpeg_error_jmp_t *jerr, FILE *fp, int target_width, int target_height)
+{
+    cinfo->err = jpeg_std_error(&jerr->pub);
+    jerr->pub.error_exit = jpeg_error_exit_jmp;
+    if (setjmp(jerr->setjmp_buffer))
+    {
+        jpeg_destroy_decompress(cinfo);
+        return false;
+    }
+
+    jpeg_create_decompress(cinfo);
+    jpeg_stdio_src(cinfo, fp);
+    jpeg_read_header(cinfo, TRUE);
+
+    cinfo->out_color_space = JCS_RGB;
+    cinfo->scale_num = 1;
+    cinfo->scale_denom = select_dct_scale_denom(cinfo->image_width, cinfo->image_height, target_width, target_height);
+    // the final resize to the model input hides the difference, take the faster IDCT and upsampling
+    cinfo->dct_method = JDCT_IFAST;
+    cinfo->do_fancy_upsampling = FALSE;
+
+    jpeg_start_decompress(cinfo);
+    if (cinfo->output_components != 3)
+    {
+        jpeg_destroy_decompress(cinfo);
+        return false;
+    }
+    return true;
+}
+
+static bool jpeg_read_rows(jpeg_decompress_struct *cinfo, jpeg_error_jmp_t *jerr, unsigned char *data, int step)
+{
+    if (setjmp(jerr->setjmp_buffer))
+    {
+        jpeg_destroy_decompress(cinfo);
+        return false;
+    }
+    while (cinfo->output_scanline < cinfo->output_height)
+    {
+        JSAMPROW row = data + (size_t)cinfo->output_scanline * step;
+        jpeg_read_scanlines(cinfo, &row, 1);
+    }
+    jpeg_finish_decompress(cinfo);
+    jpeg_destroy_decompress(cinfo);
+    return true;
+}
+
+static bool decode_jpeg_scaled(FILE *fp, int target_width, int target_height, SimpleCV::Mat &out)
+{
+    jpeg_decompress_struct cinfo;
+    jpeg_error_jmp_t jerr;
+    if (!jpeg_begin_scaled(&cinfo, &jerr, fp, target_width, target_height))
+    {
+        return false;
+    }
+
+    SimpleCV::Mat mat(cinfo.output_height, cinfo.output_width, 3);
+    if (!jpeg_read_rows(&cinfo, &jerr, mat.data, mat.step))
+    {
+        return false;
+    }
+    out = mat;
+    return true;
+}
+#endif
+
+SimpleCV::Mat imread_scaled(const std::string &path, int target_width, int target_height)
+{
+#ifdef CLIP_WITH_LIBJPEG
+    FILE *fp = fopen(path.c_str(), "rb");
+    if (fp)
+    {
+        SimpleCV::Mat out;
+        bool ok = is_jpeg(fp) && decode_jpeg_scaled(fp, target_width, target_height, out);
+        fclose(fp);
+        if (ok)
+        {
+            return out;
+        }
+    }
+#endif
+    return SimpleCV::imread(path, SimpleCV::ColorSpace::RGB);
+}
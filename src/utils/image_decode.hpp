@@ -0,0 +1,12 @@
+#pragma once
+#include <string>
+#include <SimpleCV.hpp>
+
+// Pick the libjpeg DCT scale denominator (1, 2, 4 or 8) that shrinks width x height the most
+// while still covering target_width x target_height.
+int select_dct_scale_denom(int width, int height, int target_width, int target_height);
+
+// Read an image as RGB for a model input of target_width x target_height.
+// JPEG files are decoded directly at a reduced DCT scale when built with libjpeg,
+// everything else goes through SimpleCV::imread at full resolution.
+SimpleCV::Mat imread_scaled(const std::string &path, int target_width, int target_height);
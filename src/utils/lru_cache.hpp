@@ -0,0 +1,89 @@
+#pragma once
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Thread-safe LRU map with a fixed number of entries; a capacity of 0 disables caching.
+// get() copies the value out so callers never hold references into the cache.
+template <typename K, typename V>
+class LRUCache
+{
+private:
+    typedef std::pair<K, V> entry_t;
+
+    std::list<entry_t> m_entries; // most recently used first
+    std::unordered_map<K, typename std::list<entry_t>::iterator> m_index;
+    std::mutex m_mutex;
+    size_t m_capacity;
+    long long m_hits = 0;
+    long long m_misses = 0;
+
+public:
+    explicit LRUCache(size_t capacity = 0) : m_capacity(capacity) {}
+
+    bool get(const K &key, V &value)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_index.find(key);
+        if (it == m_index.end())
+        {
+            m_misses++;
+            return false;
+        }
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        value = it->second->second;
+        m_hits++;
+        return true;
+    }
+
+    void put(const K &key, const V &value)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_capacity == 0)
+        {
+            return;
+        }
+        auto it = m_index.find(key);
+        if (it != m_index.end())
+        {
+            it->second->second = value;
+            m_entries.splice(m_entries.begin(), m_entries, it->second);
+            return;
+        }
+        m_entries.emplace_front(key, value);
+        m_index[key] = m_entries.begin();
+        while (m_entries.size() > m_capacity)
+        {
+            m_index.erase(m_entries.back().first);
+            m_entries.pop_back();
+        }
+    }
+
+    void set_capacity(size_t capacity)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_capacity = capacity;
+        while (m_entries.size() > m_capacity)
+        {
+            m_index.erase(m_entries.back().first);
+            m_entries.pop_back();
+        }
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_entries.clear();
+        m_index.clear();
+    }
+
+    void stats(long long &hits, long long &misses, size_t &size, size_t &capacity)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        hits = m_hits;
+        misses = m_misses;
+        size = m_entries.size();
+        capacity = m_capacity;
+    }
+};
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+
+// 64-bit difference hash (dHash) of an interleaved uint8 image.
+// The image is box-averaged down to a 9x8 grayscale grid, each bit is set when a cell is brighter
+// than its right neighbour. At most 8x8 source pixels are sampled per cell, so the cost does not
+// grow with the input resolution.
+static inline uint64_t dhash64(const unsigned char *data, int width, int height, int channels, int stride)
+{
+    const int GRID_W = 9, GRID_H = 8, SAMPLES = 8;
+    float grid[GRID_H][GRID_W];
+    for (int gy = 0; gy < GRID_H; gy++)
+    {
+        int y0 = gy * height / GRID_H;
+        int y1 = (gy + 1) * height / GRID_H;
+        int ystep = (y1 - y0 + SAMPLES - 1) / SAMPLES;
+        ystep = ystep > 0 ? ystep : 1;
+        for (int gx = 0; gx < GRID_W; gx++)
+        {
+            int x0 = gx * width / GRID_W;
+            int x1 = (gx + 1) * width / GRID_W;
+            int xstep = (x1 - x0 + SAMPLES - 1) / SAMPLES;
+            xstep = xstep > 0 ? xstep : 1;
+
+            float sum = 0.f;
+            int count = 0;
+            for (int y = y0; y < y1; y += ystep)
+            {
+                const unsigned char *row = data + (int64_t)y * stride;
+                for (int x = x0; x < x1; x += xstep)
+                {
+                    const unsigned char *px = row + x * channels;
+                    sum += channels >= 3 ? (px[0] + px[1] + px[2]) / 3.f : px[0];
+                    count++;
+                }
+            }
+            grid[gy][gx] = count > 0 ? sum / count : 0.f;
+        }
+    }
+
+    uint64_t hash = 0;
+    for (int gy = 0; gy < GRID_H; gy++)
+    {
+        for (int gx = 0; gx < GRID_W - 1; gx++)
+        {
+            hash = (hash << 1) | (grid[gy][gx] > grid[gy][gx + 1] ? 1 : 0);
+        }
+    }
+    return hash;
+}
+
+static inline int hamming_distance64(uint64_t a, uint64_t b)
+{
+    uint64_t x = a ^ b;
+    int count = 0;
+    while (x)
+    {
+        x &= x - 1;
+        count++;
+    }
+    return count;
+}
@@ -134,33 +134,28 @@ int main(int argc, char *argv[])
     std::string text = parser.get<std::string>("text");
 
     std::vector<std::string> image_paths = SimpleCV::glob(image_src + "/*.*");
-    auto cqdm = create_cqdm(image_paths.size(), 32);
-    for (size_t i = 0; i < image_paths.size(); i++)
+    std::vector<const char *> image_path_ptrs;
+    for (auto &image_path : image_paths)
     {
-        std::string image_path = image_paths[i];
-        // Keep keys stable across platforms (Windows paths use '\\').
-        std::string image_name = std::filesystem::path(image_path).filename().string();
-        char key[CLIP_KEY_MAX_LEN];
-        std::snprintf(key, sizeof(key), "%s", image_name.c_str());
-        if (clip_contain(handle, key))
-        {
-            // printf("%s is exist %04ld/%04ld\n", key, i, image_paths.size());
-            continue;
-        }
-
-        SimpleCV::Mat src = SimpleCV::imread(image_path, SimpleCV::ColorSpace::RGB);
-        clip_image_t image;
-        image.data = src.data;
-        image.width = src.width;
-        image.height = src.height;
-        image.channels = src.channels;
-        image.stride = src.step;
-
-        timer t;
-        clip_add(handle, key, &image, 0);
-        update_cqdm(&cqdm, i, "count", "get image embeding");
-        // printf("add image %s  %04ld/%04ld  %6.2fms\n", image_name.c_str(), i, image_paths.size(), t.cost());
+        image_path_ptrs.push_back(image_path.c_str());
     }
+    auto cqdm = create_cqdm(image_paths.size(), 32);
+
+    // keys are the file names, so they stay stable across platforms (Windows paths use '\\')
+    clip_ingest_options_t ingest_options;
+    memset(&ingest_options, 0, sizeof(ingest_options));
+    ingest_options.userdata = &cqdm;
+    timer t_ingest;
+    clip_ingest_paths(handle, image_path_ptrs.data(), image_path_ptrs.size(), &ingest_options,
+                      [](const char *path, const char *key, int status, int done, int total, void *userdata)
+                      {
+                          if (status != clip_errcode_success && status != clip_errcode_add_failed_key_exist)
+                          {
+                              printf("add image %s failed, status: 0x%x\n", path, status);
+                          }
+                          update_cqdm((t_cqdm *)userdata, done - 1, "count", "get image embeding");
+                      });
+    printf("ingest %ld images %6.2fms\n", image_paths.size(), t_ingest.cost());
     int topk = 10;
     std::vector<clip_result_item_t> results(topk);
     timer t;
@@ -0,0 +1,147 @@
+#include "clip.h"
+#include "utils/cmdline.hpp"
+#include "utils/timer.hpp"
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <random>
+#include <algorithm>
+
+// End-to-end run on mock_device: no NPU needed, the encoders are CPU mock runners loaded from spec files,
+// so tokenizer, preprocessing, storage, search and scheduling can be exercised and timed on any host.
+
+static void make_image(int idx, int width, int height, std::vector<unsigned char> &data)
+{
+    std::mt19937 rng(idx);
+    data.resize(width * height * 3);
+    int r = rng() % 256, g = rng() % 256, b = rng() % 256;
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            unsigned char *p = data.data() + (y * width + x) * 3;
+            p[0] = (unsigned char)(b + x);
+            p[1] = (unsigned char)(g + y);
+            p[2] = (unsigned char)(r + (x ^ y));
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    cmdline::parser parser;
+    parser.add<std::string>("ienc", 0, "mock image encoder spec", false, "tests/mock/clip_vision.mock");
+    parser.add<std::string>("tenc", 0, "mock text encoder spec", false, "tests/mock/clip_text.mock");
+    parser.add<std::string>("vocab", 'v', "vocab path", false, "tests/tokenizer/clip_tokenizer.txt");
+    parser.add<std::string>("db_path", 'd', "db path", false, "mock_feat_db");
+    parser.add<int>("model_type", 'm', "model type (0=unknown, 1=clip, 2=cn_clip, 3=jina_clip_v2, 4=siglip2)", false, 1);
+    parser.add<int>("num", 'n', "synthetic images to add", false, 256);
+    parser.add<int>("batch", 'b', "images per clip_add_batch call", false, 8);
+    parser.add<int>("io_slots", 0, "image encoder io slots", false, 2);
+    parser.add<std::string>("text", 't', "text query", false, "a photo of a cat");
+    parser.parse_check(argc, argv);
+
+    if (ax_dev_sys_init(mock_device, -1) != 0)
+    {
+        printf("mock device init failed\n");
+        return -1;
+    }
+
+    clip_init_t init_info;
+    memset(&init_info, 0, sizeof(init_info));
+    init_info.dev_type = mock_device;
+    sprintf(init_info.image_encoder_path, "%s", parser.get<std::string>("ienc").c_str());
+    sprintf(init_info.text_encoder_path, "%s", parser.get<std::string>("tenc").c_str());
+    sprintf(init_info.tokenizer_path, "%s", parser.get<std::string>("vocab").c_str());
+    sprintf(init_info.db_path, "%s", parser.get<std::string>("db_path").c_str());
+    init_info.model_type = (model_type_e)parser.get<int>("model_type");
+    init_info.image_io_slots = parser.get<int>("io_slots");
+    init_info.parallel_startup = 1;
+
+    clip_handle_t handle;
+    int ret = clip_create(&init_info, &handle);
+    if (ret != clip_errcode_success)
+    {
+        printf("clip_create failed, ret=0x%x\n", ret);
+        return -1;
+    }
+    clip_startup_stats_t startup;
+    clip_get_startup_stats(handle, &startup);
+    printf("startup %6.2fms\n", startup.total_ms);
+
+    const int width = 224, height = 224;
+    int num = parser.get<int>("num");
+    int batch = std::max(1, parser.get<int>("batch"));
+
+    std::vector<std::vector<unsigned char>> pixels(num);
+    std::vector<clip_image_t> images(num);
+    char(*keys)[CLIP_KEY_MAX_LEN] = new char[std::max(num, 1)][CLIP_KEY_MAX_LEN];
+    for (int i = 0; i < num; i++)
+    {
+        make_image(i, width, height, pixels[i]);
+        images[i] = {pixels[i].data(), width, height, 3, width * 3};
+        snprintf(keys[i], CLIP_KEY_MAX_LEN, "mock_%05d", i);
+    }
+
+    timer t_add;
+    std::vector<int> status(batch);
+    for (int i = 0; i < num; i += batch)
+    {
+        int count = std::min(batch, num - i);
+        clip_add_batch(handle, &keys[i], &images[i], count, 1, status.data());
+        for (int j = 0; j < count; j++)
+        {
+            if (status[j] != clip_errcode_success)
+            {
+                printf("add %s failed, status: 0x%x\n", keys[i + j], status[j]);
+            }
+        }
+    }
+    float add_ms = t_add.cost();
+    printf("add %d images %6.2fms (%6.2f images/s)\n", num, add_ms, num * 1000.0f / std::max(add_ms, 1e-3f));
+
+    // the mock embedding only depends on the input, so encoding an image again must give the same feature
+    int failed = 0;
+    if (num > 0)
+    {
+        clip_rect_t full = {0, 0, width, height};
+        clip_feature_item_t feat_a, feat_b;
+        clip_get_image_feat_rois(handle, &images[0], &full, 1, &feat_a);
+        clip_get_image_feat_rois(handle, &images[0], &full, 1, &feat_b);
+        if (feat_a.len <= 0 || feat_a.len != feat_b.len || memcmp(feat_a.feat, feat_b.feat, feat_a.len * sizeof(float)) != 0)
+        {
+            printf("image feature is not deterministic\n");
+            failed++;
+        }
+
+        clip_result_item_t top;
+        int probe = num / 2;
+        timer t_match_image;
+        clip_match_image(handle, &images[probe], &top, 1);
+        printf("match image %6.2fms, top1 %s (%6.4f)\n", t_match_image.cost(), top.key, top.score);
+        if (strcmp(top.key, keys[probe]) != 0)
+        {
+            printf("match image expected %s\n", keys[probe]);
+            failed++;
+        }
+    }
+
+    int topk = std::min(num, 5);
+    std::vector<clip_result_item_t> results(std::max(topk, 1));
+    timer t_match_text;
+    clip_match_text(handle, parser.get<std::string>("text").c_str(), results.data(), topk);
+    printf("match text \"%s\" %6.2fms\n", parser.get<std::string>("text").c_str(), t_match_text.cost());
+    for (int i = 0; i < topk; i++)
+    {
+        printf("|%32s | %6.4f|\n", results[i].key, results[i].score);
+    }
+
+    clip_destroy(handle);
+    delete[] keys;
+    ax_dev_sys_deinit(mock_device, -1);
+
+    printf("%s\n", failed ? "FAILED" : "PASSED");
+    return failed ? -1 : 0;
+}